@@ -0,0 +1,70 @@
+#!/bin/bash
+# Память AST на узел, время освобождения дерева и полная компиляция
+# большой программы.
+# Использование: ./bench_ast.sh [файл.prog ...]
+# Без аргументов генерируется программа из STATEMENTS операторов (по
+# умолчанию 60000): присваивания с вложенными выражениями, if, while и печать.
+
+COMPILER="${COMPILER:-build/bin/compiler}"
+RUNS=${RUNS:-5}
+STATEMENTS=${STATEMENTS:-60000}
+
+if [ ! -f "$COMPILER" ]; then
+    echo "Compiler not found: $COMPILER"
+    exit 1
+fi
+
+FILES=("$@")
+if [ ${#FILES[@]} -eq 0 ]; then
+    mkdir -p build
+    INPUT="build/bench_ast.prog"
+    # Без rand(), чтобы программа не зависела от реализации awk
+    awk -v n="$STATEMENTS" 'BEGIN {
+        for (v = 0; v < 14; v++) print "int v" v ";";
+        print "string s;";
+        for (v = 0; v < 14; v++) print "v" v " = " v ";";
+        print "s = \"hello\";";
+        for (i = 0; i < n; i++) {
+            a = "v" (i * 7 % 14); b = "v" (i * 11 % 14); c = "v" (i * 5 % 14);
+            k = i % 8;
+            if (k < 4)
+                print a " = (" b " + " c " * " (i % 97) ") - (" c " / (" b " + 1));";
+            else if (k == 4)
+                print "if (" a " < " b " and not (" c " == " (i % 13) ")) { " a " = " a " + 1; } else { " b " = " b " - " c "; }";
+            else if (k == 5)
+                print a " = 0; while (" a " < 3) { " c " = " c " + " a " * 2; " a " = " a " + 1; }";
+            else if (k == 6)
+                print "print (" a " + " b ") * " c ";";
+            else
+                print "print s;";
+        }
+    }' > "$INPUT"
+    FILES=("$INPUT")
+fi
+
+for file in "${FILES[@]}"; do
+    echo "=== $file ($(wc -c < "$file") bytes) ==="
+
+    # Лучший из RUNS запусков по времени освобождения
+    best=""
+    for ((run = 0; run < RUNS; run++)); do
+        line=$($COMPILER --parse-stats "$file" 2>/dev/null | grep "^AST statistics")
+        ms=$(echo "$line" | sed 's/.*teardown \([0-9.]*\) ms.*/\1/')
+        if [ -z "$best" ] || awk "BEGIN { exit !($ms < $best) }"; then
+            best=$ms
+            bestLine=$line
+        fi
+    done
+    echo "$bestLine"
+
+    # Полная компиляция в одном потоке: время и пиковая память
+    if [ -x /usr/bin/time ]; then
+        /usr/bin/time -f "Full compile: %e s, peak RSS %M KB" \
+            $COMPILER --threads=1 "$file" build/bench_ast.s >/dev/null
+    else
+        start=$(date +%s.%N)
+        $COMPILER --threads=1 "$file" build/bench_ast.s >/dev/null
+        end=$(date +%s.%N)
+        echo "Full compile: $(awk "BEGIN { printf \"%.2f\", $end - $start }") s"
+    fi
+done
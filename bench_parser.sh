@@ -0,0 +1,42 @@
+#!/bin/bash
+# Сравнение скорости разбора: Bison и анализатор, написанный вручную.
+# Использование: ./bench_parser.sh [файл.prog ...]
+# Без аргументов разбирается программа из всех tests/*.prog, повторенных
+# REPEAT раз (по умолчанию 500).
+
+COMPILER="build/bin/compiler"
+RUNS=${RUNS:-5}
+REPEAT=${REPEAT:-500}
+
+if [ ! -f "$COMPILER" ]; then
+    echo "Compiler not found: $COMPILER"
+    exit 1
+fi
+
+FILES=("$@")
+if [ ${#FILES[@]} -eq 0 ]; then
+    mkdir -p build
+    INPUT="build/bench_parser.prog"
+    : > "$INPUT"
+    for ((i = 0; i < REPEAT; i++)); do
+        cat tests/*.prog >> "$INPUT"
+    done
+    FILES=("$INPUT")
+fi
+
+for file in "${FILES[@]}"; do
+    echo "=== $file ($(wc -c < "$file") bytes) ==="
+    for parser in bison hand; do
+        # Лучший из RUNS запусков
+        best=""
+        for ((run = 0; run < RUNS; run++)); do
+            line=$($COMPILER --parser=$parser --parse-stats "$file" 2>/dev/null | grep "^Parse statistics")
+            ms=$(echo "$line" | sed 's/.* nodes, \([0-9.]*\) ms.*/\1/')
+            if [ -z "$best" ] || awk "BEGIN { exit !($ms < $best) }"; then
+                best=$ms
+                bestLine=$line
+            fi
+        done
+        echo "$bestLine"
+    done
+done
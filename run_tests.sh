@@ -1,13 +1,20 @@
 #!/bin/bash
 # Simple test script for the compiler
 
-COMPILER="build/bin/compiler"
+COMPILER="${COMPILER:-build/bin/compiler}"
 TESTS_DIR="tests"
+EXPECTED_DIR="$TESTS_DIR/expected"
 OUTPUT_DIR="build/test_outputs"
+# Вывод программы проверяется в симуляторе RV32IM, если есть python3
+SIMULATOR="tools/rvsim.py"
 
 echo "=== Educational Compiler Test Suite ==="
 echo "Compiler: $COMPILER"
 echo "Tests directory: $TESTS_DIR"
+if ! command -v python3 >/dev/null 2>&1; then
+    echo "python3 not found: program output is not checked"
+    SIMULATOR=""
+fi
 echo ""
 
 # Create output directory
@@ -17,6 +24,130 @@ TESTS_PASSED=0
 TESTS_FAILED=0
 FAILED_TESTS=()
 
+pass_test() {
+    echo "✅ PASS"
+    ((TESTS_PASSED++))
+}
+
+# fail_test <тест> <причина>
+fail_test() {
+    echo "❌ FAIL ($2)"
+    ((TESTS_FAILED++))
+    FAILED_TESTS+=("$1")
+}
+
+# check_output <тест> <файл .s> <ожидаемый вывод>: исполняет программу
+# в симуляторе и сравнивает stdout с ожидаемым; stderr программы
+# остается в <файл>.err
+check_output() {
+    local actual="${2%.s}.out"
+    if [ -z "$SIMULATOR" ] || [ ! -f "$3" ]; then
+        pass_test
+    elif ! python3 "$SIMULATOR" "$2" > "$actual" 2> "${2%.s}.err"; then
+        fail_test "$1" "runtime error"
+    elif cmp -s "$actual" "$3"; then
+        pass_test
+    else
+        fail_test "$1" "wrong output, see $actual"
+    fi
+}
+
+# check_compile <тест> <программа> <ожидаемый вывод> [флаги...]: компилирует
+# с флагами и проверяет вывод; сообщения компилятора - в $OUTPUT_DIR/<тест>.log
+check_compile() {
+    local name="$1" program="$2" expected="$3"
+    shift 3
+    echo -n "Running test: $name ... "
+    if $COMPILER "$@" "$program" "$OUTPUT_DIR/$name.s" > "$OUTPUT_DIR/$name.log" 2>&1; then
+        check_output "$name" "$OUTPUT_DIR/$name.s" "$expected"
+    else
+        fail_test "$name" "compiler error"
+    fi
+}
+
+# check_ast <тест> <программа> <ожидаемое дерево> [флаги...]: вывод
+# ast.print() из сообщений компилятора совпадает с ожидаемым
+check_ast() {
+    local name="$1" program="$2" expected="$3"
+    shift 3
+    local actual="$OUTPUT_DIR/$(basename "$program" .prog)$*.ast"
+    echo -n "Running test: $name ... "
+    $COMPILER "$@" "$program" "$OUTPUT_DIR/ast.s" 2>/dev/null |
+        sed -n '/^=== AST ===$/,/^=== Generated/p' | sed '1d;$d' > "$actual"
+    if cmp -s "$actual" "$expected"; then
+        pass_test
+    else
+        fail_test "$name" "$actual differs from $expected"
+    fi
+}
+
+# check_file <тест> <файл> <ожидаемый файл>: файлы совпадают побайтно
+check_file() {
+    echo -n "Running test: $1 ... "
+    if cmp -s "$2" "$3"; then
+        pass_test
+    else
+        fail_test "$1" "$2 differs from $3"
+    fi
+}
+
+# check_rejected <тест> <строка> [флаги...]: компилятор завершается с ошибкой
+# и сообщает строку
+check_rejected() {
+    local name="$1" message="$2"
+    shift 2
+    check_rejected_program "$name" "$TESTS_DIR/test.prog" "$message" "$@"
+}
+
+# check_rejected_program <тест> <программа> <строка> [флаги...]: то же для
+# заданной программы; падение по сигналу - тоже ошибка теста
+check_rejected_program() {
+    local name="$1" program="$2" message="$3" status
+    shift 3
+    echo -n "Running test: $name ... "
+    $COMPILER "$@" "$program" "$OUTPUT_DIR/$name.s" > "$OUTPUT_DIR/$name.log" 2>&1
+    status=$?
+    if [ $status -eq 0 ]; then
+        fail_test "$name" "accepted"
+    elif [ $status -gt 128 ]; then
+        fail_test "$name" "crashed with status $status"
+    elif grep -qF -- "$message" "$OUTPUT_DIR/$name.log"; then
+        pass_test
+    else
+        fail_test "$name" "no \"$message\" in $OUTPUT_DIR/$name.log"
+    fi
+}
+
+# check_log <тест> <строка>: сообщения компилятора в тесте содержат строку
+check_log() {
+    echo -n "Running test: $1 reports \"$2\" ... "
+    if grep -qF -- "$2" "$OUTPUT_DIR/$1.log"; then
+        pass_test
+    else
+        fail_test "$1" "no \"$2\" in $OUTPUT_DIR/$1.log"
+    fi
+}
+
+# check_asm <тест> <строка>: код теста содержит строку
+check_asm() {
+    echo -n "Running test: $1 emits \"$2\" ... "
+    if grep -qF -- "$2" "$OUTPUT_DIR/$1.s"; then
+        pass_test
+    else
+        fail_test "$1" "no \"$2\" in $OUTPUT_DIR/$1.s"
+    fi
+}
+
+# check_no_log <тест> <строка>: строки в сообщениях компилятора нет
+check_no_log() {
+    echo -n "Running test: $1 does not report \"$2\" ... "
+    if grep -qF -- "$2" "$OUTPUT_DIR/$1.log"; then
+        fail_test "$1" "unexpected \"$2\" in $OUTPUT_DIR/$1.log"
+    else
+        pass_test
+    fi
+}
+
 # Test all .prog files
 for test_file in "$TESTS_DIR"/*.prog; do
     if [ -f "$test_file" ]; then
@@ -27,21 +158,156 @@ for test_file in "$TESTS_DIR"/*.prog; do
         
         if $COMPILER "$test_file" "$output_file" >/dev/null 2>&1; then
             if [ -f "$output_file" ]; then
-                echo "✅ PASS"
-                ((TESTS_PASSED++))
+                check_output "$test_name" "$output_file" "$EXPECTED_DIR/${test_name%.prog}.out"
             else
-                echo "❌ FAIL (no output)"
-                ((TESTS_FAILED++))
-                FAILED_TESTS+=("$test_name")
+                fail_test "$test_name" "no output"
             fi
         else
-            echo "❌ FAIL (compiler error)"
-            ((TESTS_FAILED++))
-            FAILED_TESTS+=("$test_name")
+            fail_test "$test_name" "compiler error"
         fi
     fi
 done
 
+# Дерево разбора каждого теста совпадает с ожидаемым у обоих анализаторов,
+# а код по дереву --parser=hand - с кодом по дереву Bison
+for test_file in "$TESTS_DIR"/*.prog; do
+    test_name=$(basename "$test_file" .prog)
+    if [ -f "$EXPECTED_DIR/$test_name.ast" ]; then
+        check_ast "$test_name AST" "$test_file" "$EXPECTED_DIR/$test_name.ast"
+        check_ast "$test_name AST with --parser=hand" "$test_file" \
+            "$EXPECTED_DIR/$test_name.ast" --parser=hand
+    fi
+    $COMPILER --parser=hand "$test_file" "$OUTPUT_DIR/$test_name.hand.s" >/dev/null 2>&1
+    check_file "$test_name assembly with --parser=hand" "$OUTPUT_DIR/$test_name.hand.s" \
+        "$OUTPUT_DIR/$test_name.prog.s"
+done
+
+# Синтаксические ошибки: оба анализатора отвергают программу, а
+# --parser=hand после восстановления перечисляет все ошибки с номерами строк
+for test_file in "$TESTS_DIR"/errors/*.prog; do
+    test_name=$(basename "$test_file" .prog)
+    check_rejected_program "$test_name-bison" "$test_file" "Parser error at line" --parser=bison
+    check_rejected_program "$test_name-hand" "$test_file" "Parser error at line" --parser=hand
+    $COMPILER --parser=hand "$test_file" "$OUTPUT_DIR/$test_name.s" 2> "$OUTPUT_DIR/$test_name.err" >/dev/null
+    check_file "$test_name error list" "$OUTPUT_DIR/$test_name.err" "$EXPECTED_DIR/$test_name.err"
+done
+
+# Вложенность: 9000 скобок разбираются, 10001 упираются в предел 10000
+# без переполнения стека
+for depth in 9000 10001; do
+    awk -v n=$depth 'BEGIN {
+        printf "int x;\nx = ";
+        for (i = 0; i < n; i++) printf "(";
+        printf "1";
+        for (i = 0; i < n; i++) printf ")";
+        print ";\nprint x;";
+    }' > "$OUTPUT_DIR/nesting-$depth.prog"
+done
+echo 1 > "$OUTPUT_DIR/nesting.out"
+for parser in bison hand; do
+    check_compile "nesting-9000-$parser" "$OUTPUT_DIR/nesting-9000.prog" \
+        "$OUTPUT_DIR/nesting.out" --parser=$parser
+done
+check_rejected_program nesting-10001-bison "$OUTPUT_DIR/nesting-10001.prog" \
+    "memory exhausted" --parser=bison
+check_rejected_program nesting-10001-hand "$OUTPUT_DIR/nesting-10001.prog" \
+    "nesting too deep" --parser=hand
+
+# Профиль: сбор счетчиков, сборка по ним и профиль от другой программы
+if [ -n "$SIMULATOR" ]; then
+    check_compile profile-generate "$TESTS_DIR/test_complex.prog" \
+        "$EXPECTED_DIR/test_complex.out" -fprofile-generate
+    PROFILE="$OUTPUT_DIR/profile-generate.err"
+    check_compile profile-use "$TESTS_DIR/test_complex.prog" \
+        "$EXPECTED_DIR/test_complex.out" "-fprofile-use=$PROFILE"
+    check_log profile-use "Variable access estimate: profile counts"
+    check_no_log profile-use "Warning"
+    check_compile profile-mismatch "$TESTS_DIR/test.prog" \
+        "$EXPECTED_DIR/test.out" "-fprofile-use=$PROFILE"
+    check_log profile-mismatch "ignoring profile"
+    check_log profile-mismatch "Promoted 3 of 4 variables"
+    # Обрезанный профиль: счетчиков в файле меньше, чем в заголовке
+    head -c -4 "$PROFILE" > "$OUTPUT_DIR/profile-truncated.bin"
+    check_rejected profile-truncated "Error: Could not read profile" \
+        "-fprofile-use=$OUTPUT_DIR/profile-truncated.bin"
+fi
+
+# Заголовок с 0x7fffffff счетчиками без самих счетчиков
+printf 'RVPF\377\377\377\177' > "$OUTPUT_DIR/profile-oversized.bin"
+check_rejected profile-oversized "Error: Could not read profile" \
+    "-fprofile-use=$OUTPUT_DIR/profile-oversized.bin"
+
+# Уровни оптимизации: вывод каждой программы не зависит от уровня
+for level in -O0 -O1 -O2 -Os; do
+    for expected in "$EXPECTED_DIR"/*.out; do
+        test_name=$(basename "$expected" .out)
+        check_compile "$test_name$level" "$TESTS_DIR/$test_name.prog" "$expected" $level
+    done
+done
+check_log test_cse-O0 "Promoted 0 of 4 variables"
+check_log test_cse-O1 "Promoted 4 of 4 variables"
+
+# Кадр больше 2048 байт: выделяется через t0, дальние слоты и переменные
+# адресуются через t0 от s0
+for test_name in test_big_frame_variables test_big_frame_expression; do
+    check_asm "$test_name-O0" "sub sp, sp, t0"
+    check_asm "$test_name-O0" "add t0, t0, s0"
+done
+
+# Свой список проходов: повторы и любой порядок внутри AST и CFG проходов
+check_compile passes-custom "$TESTS_DIR/test_cse.prog" "$EXPECTED_DIR/test_cse.out" \
+    --passes=cse,promote,thread-jumps,merge-blocks,thread-jumps,layout --pass-stats
+check_log passes-custom "=== Pass Statistics ==="
+check_compile passes-empty "$TESTS_DIR/test_nested_control.prog" \
+    "$EXPECTED_DIR/test_nested_control.out" --passes=
+check_rejected passes-unknown "unknown pass frobnicate" --passes=promote,frobnicate
+check_rejected passes-order "must precede CFG passes" --passes=layout,cse
+
+# Выполнение при компиляции: вывод тот же, что у обычного кода
+for expected in "$EXPECTED_DIR"/*.out; do
+    test_name=$(basename "$expected" .out)
+    check_compile "$test_name-precompute" "$TESTS_DIR/$test_name.prog" "$expected" --precompute
+done
+check_log test_precompute-precompute "Program finished at compile time"
+check_compile precompute-budget "$TESTS_DIR/test_print_buffer.prog" \
+    "$EXPECTED_DIR/test_print_buffer.out" --precompute=50
+check_log precompute-budget "step budget of 50 exceeded"
+
+# Случайные программы: эталонный интерпретатор, сборка с --precompute и без
+if [ -n "$SIMULATOR" ]; then
+    echo -n "Running test: difftest ... "
+    if python3 tools/difftest.py --compiler "$COMPILER" --count 100 --precompute \
+        --keep "$OUTPUT_DIR/difftest" > "$OUTPUT_DIR/difftest.log"; then
+        pass_test
+    else
+        fail_test difftest "see $OUTPUT_DIR/difftest.log"
+    fi
+fi
+
+# Отчет о стоимости в тексте и в JSON (с другим числом итераций циклов)
+check_compile cost-text "$TESTS_DIR/test_nested_control.prog" \
+    "$EXPECTED_DIR/test_nested_control.out" --cost-report="$OUTPUT_DIR/cost.txt"
+check_file "cost-text report" "$OUTPUT_DIR/cost.txt" "$EXPECTED_DIR/test_nested_control.cost.txt"
+check_compile cost-json "$TESTS_DIR/test_nested_control.prog" \
+    "$EXPECTED_DIR/test_nested_control.out" --cost-report="$OUTPUT_DIR/cost.json" \
+    --cost-format=json --trip-count=3
+check_file "cost-json report" "$OUTPUT_DIR/cost.json" "$EXPECTED_DIR/test_nested_control.cost.json"
+
+# Параллельная генерация: код и отчет побайтно совпадают с одним потоком
+for threads in 1 4; do
+    check_compile "threads-$threads" "$TESTS_DIR/test_many_statements.prog" \
+        "$EXPECTED_DIR/test_many_statements.out" --threads=$threads \
+        --cost-report="$OUTPUT_DIR/threads-$threads.cost"
+done
+check_file "threads-4 assembly" "$OUTPUT_DIR/threads-4.s" "$OUTPUT_DIR/threads-1.s"
+check_file "threads-4 cost report" "$OUTPUT_DIR/threads-4.cost" "$OUTPUT_DIR/threads-1.cost"
+
+# Продвижение переменных: регистров s1-s11 меньше, чем переменных
+check_compile promote-many "$TESTS_DIR/test_many_variables.prog" \
+    "$EXPECTED_DIR/test_many_variables.out"
+check_log promote-many "Promoted 11 of 14 variables"
+check_log promote-many "rare3: stack"
+
 echo ""
 echo "=== Test Results ==="
 echo "Tests passed: $TESTS_PASSED"
@@ -1,10 +1,8 @@
 #include "ast.hpp"
-#include "codegen.hpp"
 #include <iostream>
 
-// Глобальная переменная для корня AST
-std::unique_ptr<ProgramNode> root;
-ProgramNode *parsed_program = nullptr;
+// AST, в который строит дерево парсер
+Ast *parse_ast = nullptr;
 
 void indent_print(int indent)
 {
@@ -14,255 +12,234 @@ void indent_print(int indent)
     }
 }
 
-// Реализация ProgramNode
-void ProgramNode::print(int indent) const
+NodeId Ast::add(NodeKind kind, uint8_t op, uint32_t a, uint32_t b, uint32_t c)
 {
-    indent_print(indent);
-    std::cout << "Program:" << std::endl;
-    std::cout << "  Number of statements: " << statements.size() << std::endl;
+    nodes.push_back({kind, op, 0, a, b, c});
+    return static_cast<NodeId>(nodes.size() - 1);
+}
 
-    for (size_t i = 0; i < statements.size(); ++i)
+uint32_t Ast::addList(const std::vector<NodeId> &statements)
+{
+    uint32_t first = static_cast<uint32_t>(lists.size());
+    lists.insert(lists.end(), statements.begin(), statements.end());
+    return first;
+}
+
+uint32_t Ast::intern(const std::string &text)
+{
+    auto it = stringIds.find(text);
+    if (it != stringIds.end())
     {
-        if (statements[i])
-        {
-            statements[i]->print(indent + 1);
-        }
-        else
-        {
-            std::cout << "  Statement " << i << " is nullptr!" << std::endl;
-        }
+        return it->second;
     }
+    uint32_t id = static_cast<uint32_t>(strings.size());
+    strings.push_back(text);
+    stringIds[text] = id;
+    return id;
 }
 
-void ProgramNode::accept(CodeGenerator &generator)
+NodeId Ast::varDecl(VarType type, const std::string &name)
 {
-    generator.visit(*this);
+    return add(NodeKind::VAR_DECL, static_cast<uint8_t>(type), intern(name), 0, 0);
 }
 
-// Реализация VarDeclNode
-void VarDeclNode::print(int indent) const
+NodeId Ast::assign(const std::string &variable, NodeId expression)
 {
-    indent_print(indent);
-    std::cout << "VarDecl: " << (type == VarType::INT ? "int" : "string")
-              << " " << name << std::endl;
+    return add(NodeKind::ASSIGN, 0, intern(variable), expression, 0);
 }
 
-void VarDeclNode::accept(CodeGenerator &generator)
+NodeId Ast::printStmt(NodeId expression)
 {
-    generator.visit(*this);
+    return add(NodeKind::PRINT, 0, 0, expression, 0);
 }
 
-// Реализация AssignNode
-void AssignNode::print(int indent) const
+NodeId Ast::ifStmt(NodeId condition, NodeId thenStmt, NodeId elseStmt)
 {
-    indent_print(indent);
-    std::cout << "Assign: " << variable << " =" << std::endl;
-    expression->print(indent + 1);
+    return add(NodeKind::IF, 0, condition, thenStmt, elseStmt);
 }
 
-void AssignNode::accept(CodeGenerator &generator)
+NodeId Ast::whileStmt(NodeId condition, NodeId body)
 {
-    generator.visit(*this);
+    return add(NodeKind::WHILE, 0, condition, body, 0);
 }
 
-// Реализация PrintNode
-void PrintNode::print(int indent) const
+NodeId Ast::block(const std::vector<NodeId> &statements)
 {
-    indent_print(indent);
-    std::cout << "Print:" << std::endl;
-    expression->print(indent + 1);
+    return add(NodeKind::BLOCK, 0, addList(statements), static_cast<uint32_t>(statements.size()), 0);
 }
 
-void PrintNode::accept(CodeGenerator &generator)
+NodeId Ast::program(const std::vector<NodeId> &statements)
 {
-    generator.visit(*this);
+    return add(NodeKind::PROGRAM, 0, addList(statements), static_cast<uint32_t>(statements.size()), 0);
 }
 
-// Реализация IfNode
-void IfNode::print(int indent) const
+NodeId Ast::binaryOp(BinOpType op, NodeId left, NodeId right)
 {
-    indent_print(indent);
-    std::cout << "If:" << std::endl;
-    indent_print(indent + 1);
-    std::cout << "Condition:" << std::endl;
-    if (condition)
-    {
-        condition->print(indent + 2);
-    }
-    else
-    {
-        std::cout << "  condition is nullptr!" << std::endl;
-    }
-    indent_print(indent + 1);
-    std::cout << "Then:" << std::endl;
-    if (thenStmt)
-    {
-        thenStmt->print(indent + 2);
-    }
-    else
-    {
-        std::cout << "  thenStmt is nullptr!" << std::endl;
-    }
-    if (elseStmt)
-    {
-        indent_print(indent + 1);
-        std::cout << "Else:" << std::endl;
-        elseStmt->print(indent + 2);
-    }
+    return add(NodeKind::BINARY_OP, static_cast<uint8_t>(op), left, right, 0);
 }
 
-void IfNode::accept(CodeGenerator &generator)
+NodeId Ast::unaryOp(NodeId operand)
 {
-    generator.visit(*this);
+    return add(NodeKind::UNARY_OP, 0, operand, 0, 0);
 }
 
-// Реализация WhileNode
-void WhileNode::print(int indent) const
+NodeId Ast::intLiteral(int value)
 {
-    indent_print(indent);
-    std::cout << "While:" << std::endl;
-    indent_print(indent + 1);
-    std::cout << "Condition:" << std::endl;
-    if (condition)
-    {
-        condition->print(indent + 2);
-    }
-    else
-    {
-        std::cout << "  condition is nullptr!" << std::endl;
-    }
-    indent_print(indent + 1);
-    std::cout << "Body:" << std::endl;
-    if (body)
-    {
-        body->print(indent + 2);
-    }
-    else
-    {
-        std::cout << "  body is nullptr!" << std::endl;
-    }
+    return add(NodeKind::INT_LITERAL, 0, static_cast<uint32_t>(value), 0, 0);
 }
 
-void WhileNode::accept(CodeGenerator &generator)
+NodeId Ast::stringLiteral(const std::string &value)
 {
-    generator.visit(*this);
+    return add(NodeKind::STRING_LITERAL, 0, intern(value), 0, 0);
 }
 
-// Реализация BlockNode
-void BlockNode::print(int indent) const
+NodeId Ast::identifier(const std::string &name)
 {
-    indent_print(indent);
-    std::cout << "Block:" << std::endl;
-    for (const auto &stmt : statements)
-    {
-        stmt->print(indent + 1);
-    }
+    return add(NodeKind::IDENTIFIER, 0, intern(name), 0, 0);
 }
 
-void BlockNode::accept(CodeGenerator &generator)
+void Ast::setRoot(NodeId id)
 {
-    generator.visit(*this);
+    // Дерево достроено: запас емкости массивов больше не нужен
+    rootId = id;
+    nodes.shrink_to_fit();
+    lists.shrink_to_fit();
 }
 
-// Реализация BinaryOpNode
-void BinaryOpNode::print(int indent) const
+void Ast::clear()
+{
+    // Несколько освобождений памяти вместо обхода всех узлов
+    std::vector<Node>().swap(nodes);
+    std::vector<NodeId>().swap(lists);
+    std::vector<std::string>().swap(strings);
+    std::unordered_map<std::string, uint32_t>().swap(stringIds);
+    rootId = NO_NODE;
+}
+
+size_t Ast::memoryUsage() const
+{
+    size_t bytes = nodes.capacity() * sizeof(Node) + lists.capacity() * sizeof(NodeId) +
+                   strings.capacity() * sizeof(std::string);
+    for (const auto &text : strings)
+    {
+        bytes += text.capacity() + 1;
+    }
+    return bytes;
+}
+
+static const char *binOpName(BinOpType op)
 {
-    indent_print(indent);
-    std::string opStr;
     switch (op)
     {
     case BinOpType::PLUS:
-        opStr = "+";
-        break;
+        return "+";
     case BinOpType::MINUS:
-        opStr = "-";
-        break;
+        return "-";
     case BinOpType::MUL:
-        opStr = "*";
-        break;
+        return "*";
     case BinOpType::DIV:
-        opStr = "/";
-        break;
+        return "/";
     case BinOpType::EQ:
-        opStr = "==";
-        break;
+        return "==";
     case BinOpType::NEQ:
-        opStr = "!=";
-        break;
+        return "!=";
     case BinOpType::LT:
-        opStr = "<";
-        break;
+        return "<";
     case BinOpType::LE:
-        opStr = "<=";
-        break;
+        return "<=";
     case BinOpType::GT:
-        opStr = ">";
-        break;
+        return ">";
     case BinOpType::GE:
-        opStr = ">=";
-        break;
+        return ">=";
     case BinOpType::AND:
-        opStr = "and";
-        break;
+        return "and";
     case BinOpType::OR:
-        opStr = "or";
-        break;
+        return "or";
     }
-    std::cout << "BinaryOp: " << opStr << std::endl;
-    left->print(indent + 1);
-    right->print(indent + 1);
-}
-
-void BinaryOpNode::accept(CodeGenerator &generator)
-{
-    generator.visit(*this);
-}
-
-// Реализация UnaryOpNode
-void UnaryOpNode::print(int indent) const
-{
-    indent_print(indent);
-    std::cout << "UnaryOp: not" << std::endl;
-    operand->print(indent + 1);
-}
-
-void UnaryOpNode::accept(CodeGenerator &generator)
-{
-    generator.visit(*this);
+    return "";
 }
 
-// Реализация IntLiteralNode
-void IntLiteralNode::print(int indent) const
+void Ast::print() const
 {
-    indent_print(indent);
-    std::cout << "IntLiteral: " << value << std::endl;
-}
-
-void IntLiteralNode::accept(CodeGenerator &generator)
-{
-    generator.visit(*this);
-}
-
-// Реализация StringLiteralNode
-void StringLiteralNode::print(int indent) const
-{
-    indent_print(indent);
-    std::cout << "StringLiteral: " << value << std::endl;
-}
-
-void StringLiteralNode::accept(CodeGenerator &generator)
-{
-    generator.visit(*this);
+    if (rootId != NO_NODE)
+    {
+        printNode(rootId, 0);
+    }
 }
 
-// Реализация IdentifierNode
-void IdentifierNode::print(int indent) const
+void Ast::printNode(NodeId id, int indent) const
 {
     indent_print(indent);
-    std::cout << "Identifier: " << name << std::endl;
+    switch (kind(id))
+    {
+    case NodeKind::PROGRAM:
+        std::cout << "Program:\n";
+        std::cout << "  Number of statements: " << statements(id).size() << "\n";
+        for (NodeId stmt : statements(id))
+        {
+            printNode(stmt, indent + 1);
+        }
+        break;
+    case NodeKind::VAR_DECL:
+        std::cout << "VarDecl: " << (varType(id) == VarType::INT ? "int" : "string") << " "
+                  << name(id) << "\n";
+        break;
+    case NodeKind::ASSIGN:
+        std::cout << "Assign: " << name(id) << " =\n";
+        printNode(expression(id), indent + 1);
+        break;
+    case NodeKind::PRINT:
+        std::cout << "Print:\n";
+        printNode(expression(id), indent + 1);
+        break;
+    case NodeKind::IF:
+        std::cout << "If:\n";
+        indent_print(indent + 1);
+        std::cout << "Condition:\n";
+        printNode(condition(id), indent + 2);
+        indent_print(indent + 1);
+        std::cout << "Then:\n";
+        printNode(thenStmt(id), indent + 2);
+        if (elseStmt(id) != NO_NODE)
+        {
+            indent_print(indent + 1);
+            std::cout << "Else:\n";
+            printNode(elseStmt(id), indent + 2);
+        }
+        break;
+    case NodeKind::WHILE:
+        std::cout << "While:\n";
+        indent_print(indent + 1);
+        std::cout << "Condition:\n";
+        printNode(condition(id), indent + 2);
+        indent_print(indent + 1);
+        std::cout << "Body:\n";
+        printNode(body(id), indent + 2);
+        break;
+    case NodeKind::BLOCK:
+        std::cout << "Block:\n";
+        for (NodeId stmt : statements(id))
+        {
+            printNode(stmt, indent + 1);
+        }
+        break;
+    case NodeKind::BINARY_OP:
+        std::cout << "BinaryOp: " << binOpName(binOp(id)) << "\n";
+        printNode(left(id), indent + 1);
+        printNode(right(id), indent + 1);
+        break;
+    case NodeKind::UNARY_OP:
+        std::cout << "UnaryOp: not\n";
+        printNode(operand(id), indent + 1);
+        break;
+    case NodeKind::INT_LITERAL:
+        std::cout << "IntLiteral: " << intValue(id) << "\n";
+        break;
+    case NodeKind::STRING_LITERAL:
+        std::cout << "StringLiteral: " << stringValue(id) << "\n";
+        break;
+    case NodeKind::IDENTIFIER:
+        std::cout << "Identifier: " << name(id) << "\n";
+        break;
+    }
 }
-
-void IdentifierNode::accept(CodeGenerator &generator)
-{
-    generator.visit(*this);
-}
\ No newline at end of file
@@ -1,127 +1,20 @@
 #ifndef AST_HPP
 #define AST_HPP
 
+#include <cstdint>
 #include <string>
+#include <unordered_map>
 #include <vector>
-#include <memory>
-
-// Базовый класс для всех узлов AST
-class ASTNode
-{
-public:
-    virtual ~ASTNode() = default;
-    virtual void print(int indent = 0) const = 0;
-    virtual void accept(class CodeGenerator &generator) = 0;
-};
 
 // Типы переменных
-enum class VarType
+enum class VarType : uint8_t
 {
     INT,
     STRING
 };
 
-// Узел программы (корневой)
-class ProgramNode : public ASTNode
-{
-public:
-    std::vector<std::unique_ptr<ASTNode>> statements;
-
-    void addStatement(std::unique_ptr<ASTNode> stmt)
-    {
-        statements.push_back(std::move(stmt));
-    }
-
-    void print(int indent = 0) const override;
-    void accept(class CodeGenerator &generator) override;
-};
-
-// Узел объявления переменной
-class VarDeclNode : public ASTNode
-{
-public:
-    VarType type;
-    std::string name;
-
-    VarDeclNode(VarType t, const std::string &n) : type(t), name(n) {}
-
-    void print(int indent = 0) const override;
-    void accept(class CodeGenerator &generator) override;
-};
-
-// Узел присваивания
-class AssignNode : public ASTNode
-{
-public:
-    std::string variable;
-    std::unique_ptr<ASTNode> expression;
-
-    AssignNode(const std::string &var, std::unique_ptr<ASTNode> expr)
-        : variable(var), expression(std::move(expr)) {}
-
-    void print(int indent = 0) const override;
-    void accept(class CodeGenerator &generator) override;
-};
-
-// Узел печати
-class PrintNode : public ASTNode
-{
-public:
-    std::unique_ptr<ASTNode> expression;
-
-    PrintNode(std::unique_ptr<ASTNode> expr) : expression(std::move(expr)) {}
-
-    void print(int indent = 0) const override;
-    void accept(class CodeGenerator &generator) override;
-};
-
-// Узел условного оператора
-class IfNode : public ASTNode
-{
-public:
-    std::unique_ptr<ASTNode> condition;
-    std::unique_ptr<ASTNode> thenStmt;
-    std::unique_ptr<ASTNode> elseStmt; // может быть nullptr
-
-    IfNode(std::unique_ptr<ASTNode> cond, std::unique_ptr<ASTNode> then,
-           std::unique_ptr<ASTNode> els = nullptr)
-        : condition(std::move(cond)), thenStmt(std::move(then)), elseStmt(std::move(els)) {}
-
-    void print(int indent = 0) const override;
-    void accept(class CodeGenerator &generator) override;
-};
-
-// Узел цикла while
-class WhileNode : public ASTNode
-{
-public:
-    std::unique_ptr<ASTNode> condition;
-    std::unique_ptr<ASTNode> body;
-
-    WhileNode(std::unique_ptr<ASTNode> cond, std::unique_ptr<ASTNode> b)
-        : condition(std::move(cond)), body(std::move(b)) {}
-
-    void print(int indent = 0) const override;
-    void accept(class CodeGenerator &generator) override;
-};
-
-// Узел блока
-class BlockNode : public ASTNode
-{
-public:
-    std::vector<std::unique_ptr<ASTNode>> statements;
-
-    void addStatement(std::unique_ptr<ASTNode> stmt)
-    {
-        statements.push_back(std::move(stmt));
-    }
-
-    void print(int indent = 0) const override;
-    void accept(class CodeGenerator &generator) override;
-};
-
 // Типы бинарных операций
-enum class BinOpType
+enum class BinOpType : uint8_t
 {
     PLUS,
     MINUS,
@@ -137,71 +30,124 @@ enum class BinOpType
     OR
 };
 
-// Узел бинарной операции
-class BinaryOpNode : public ASTNode
+// Вид узла и назначение его полей
+enum class NodeKind : uint8_t
 {
-public:
-    BinOpType op;
-    std::unique_ptr<ASTNode> left;
-    std::unique_ptr<ASTNode> right;
-
-    BinaryOpNode(BinOpType o, std::unique_ptr<ASTNode> l, std::unique_ptr<ASTNode> r)
-        : op(o), left(std::move(l)), right(std::move(r)) {}
-
-    void print(int indent = 0) const override;
-    void accept(class CodeGenerator &generator) override;
+    PROGRAM,        // a - начало списка операторов, b - их число
+    VAR_DECL,       // op - VarType, a - имя
+    ASSIGN,         // a - имя переменной, b - выражение
+    PRINT,          // b - выражение
+    IF,             // a - условие, b - then, c - else (NO_NODE, если нет)
+    WHILE,          // a - условие, b - тело
+    BLOCK,          // a - начало списка операторов, b - их число
+    BINARY_OP,      // op - BinOpType, a - левый операнд, b - правый
+    UNARY_OP,       // a - операнд (not)
+    INT_LITERAL,    // a - значение
+    STRING_LITERAL, // a - строка в кавычках, как в исходном тексте
+    IDENTIFIER      // a - имя
 };
 
-// Узел унарной операции
-class UnaryOpNode : public ASTNode
-{
-public:
-    std::unique_ptr<ASTNode> operand;
-
-    UnaryOpNode(std::unique_ptr<ASTNode> op) : operand(std::move(op)) {}
+// Номер узла в массиве узлов AST
+typedef uint32_t NodeId;
+const NodeId NO_NODE = 0xFFFFFFFFu;
 
-    void print(int indent = 0) const override;
-    void accept(class CodeGenerator &generator) override;
-};
-
-// Узел целочисленного литерала
-class IntLiteralNode : public ASTNode
+// Узел - запись фиксированного размера без указателей: потомки, имена
+// и списки задаются 32-битными номерами
+struct Node
 {
-public:
-    int value;
-
-    IntLiteralNode(int v) : value(v) {}
-
-    void print(int indent = 0) const override;
-    void accept(class CodeGenerator &generator) override;
+    NodeKind kind;
+    uint8_t op;
+    uint32_t line; // строка исходного кода (для операторов)
+    uint32_t a;
+    uint32_t b;
+    uint32_t c;
 };
 
-// Узел строкового литерала
-class StringLiteralNode : public ASTNode
+// Операторы блока или программы: отрезок массива списков
+struct NodeList
 {
-public:
-    std::string value;
+    const NodeId *first;
+    const NodeId *last;
 
-    StringLiteralNode(const std::string &v) : value(v) {}
-
-    void print(int indent = 0) const override;
-    void accept(class CodeGenerator &generator) override;
+    const NodeId *begin() const { return first; }
+    const NodeId *end() const { return last; }
+    size_t size() const { return static_cast<size_t>(last - first); }
+    NodeId operator[](size_t i) const { return first[i]; }
 };
 
-// Узел идентификатора
-class IdentifierNode : public ASTNode
+// AST программы. Узлы, списки операторов и строки лежат в непрерывных
+// массивах, поэтому дерево освобождается целиком, без обхода узлов,
+// а обход идет по памяти подряд. Имена и строковые литералы хранятся
+// один раз (интернирование).
+class Ast
 {
-public:
-    std::string name;
+private:
+    std::vector<Node> nodes;
+    std::vector<NodeId> lists;
+    std::vector<std::string> strings;
+    std::unordered_map<std::string, uint32_t> stringIds;
+    NodeId rootId;
+
+    NodeId add(NodeKind kind, uint8_t op, uint32_t a, uint32_t b, uint32_t c);
+    uint32_t addList(const std::vector<NodeId> &statements);
+    uint32_t intern(const std::string &text);
+    void printNode(NodeId id, int indent) const;
 
-    IdentifierNode(const std::string &n) : name(n) {}
-
-    void print(int indent = 0) const override;
-    void accept(class CodeGenerator &generator) override;
+public:
+    Ast() : rootId(NO_NODE) {}
+
+    // Построение (парсер)
+    NodeId varDecl(VarType type, const std::string &name);
+    NodeId assign(const std::string &variable, NodeId expression);
+    NodeId printStmt(NodeId expression);
+    NodeId ifStmt(NodeId condition, NodeId thenStmt, NodeId elseStmt = NO_NODE);
+    NodeId whileStmt(NodeId condition, NodeId body);
+    NodeId block(const std::vector<NodeId> &statements);
+    NodeId program(const std::vector<NodeId> &statements);
+    NodeId binaryOp(BinOpType op, NodeId left, NodeId right);
+    NodeId unaryOp(NodeId operand);
+    NodeId intLiteral(int value);
+    NodeId stringLiteral(const std::string &value);
+    NodeId identifier(const std::string &name);
+    void setLine(NodeId id, int line) { nodes[id].line = static_cast<uint32_t>(line); }
+    void setRoot(NodeId id);
+    void clear();
+
+    // Чтение
+    NodeId root() const { return rootId; }
+    size_t size() const { return nodes.size(); }
+    const Node &node(NodeId id) const { return nodes[id]; }
+    NodeKind kind(NodeId id) const { return nodes[id].kind; }
+    int line(NodeId id) const { return static_cast<int>(nodes[id].line); }
+
+    NodeList statements(NodeId id) const // PROGRAM, BLOCK
+    {
+        const NodeId *first = lists.data() + nodes[id].a;
+        return {first, first + nodes[id].b};
+    }
+    // VAR_DECL, ASSIGN, IDENTIFIER
+    const std::string &name(NodeId id) const { return strings[nodes[id].a]; }
+    const std::string &stringValue(NodeId id) const { return strings[nodes[id].a]; }
+    int intValue(NodeId id) const { return static_cast<int>(nodes[id].a); }
+    VarType varType(NodeId id) const { return static_cast<VarType>(nodes[id].op); }
+    BinOpType binOp(NodeId id) const { return static_cast<BinOpType>(nodes[id].op); }
+    NodeId expression(NodeId id) const { return nodes[id].b; } // ASSIGN, PRINT
+    NodeId condition(NodeId id) const { return nodes[id].a; }  // IF, WHILE
+    NodeId thenStmt(NodeId id) const { return nodes[id].b; }
+    NodeId elseStmt(NodeId id) const { return nodes[id].c; }
+    NodeId body(NodeId id) const { return nodes[id].b; }
+    NodeId left(NodeId id) const { return nodes[id].a; }
+    NodeId right(NodeId id) const { return nodes[id].b; }
+    NodeId operand(NodeId id) const { return nodes[id].a; }
+
+    // Память под массивы дерева в байтах (с учетом запаса vector)
+    size_t memoryUsage() const;
+
+    // Визуализация дерева в stdout
+    void print() const;
 };
 
-// Глобальная переменная для корня AST
-extern std::unique_ptr<ProgramNode> root;
-extern class ProgramNode *parsed_program;
+// AST, в который строит дерево парсер
+extern Ast *parse_ast;
 
-#endif // AST_HPP
\ No newline at end of file
+#endif // AST_HPP
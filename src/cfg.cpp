@@ -0,0 +1,372 @@
+#include "cfg.hpp"
+#include <algorithm>
+#include <numeric>
+
+int ControlFlowGraph::createBlock()
+{
+    blocks.emplace_back();
+    return static_cast<int>(blocks.size()) - 1;
+}
+
+void ControlFlowGraph::placeBlock(int id, double freq)
+{
+    blocks[id].order = placedCount++;
+    blocks[id].freq = freq;
+}
+
+int ControlFlowGraph::resolveTarget(int id) const
+{
+    // Пустой блок с безусловным переходом заменяем его целью
+    size_t steps = 0;
+    while (blocks[id].code.empty() && blocks[id].exit == BasicBlock::Exit::JUMP &&
+           steps++ < blocks.size())
+    {
+        id = blocks[id].target;
+    }
+    return id;
+}
+
+int ControlFlowGraph::threadJumps()
+{
+    int changes = 0;
+    for (auto &b : blocks)
+    {
+        if (b.removed || b.exit == BasicBlock::Exit::RETURN)
+        {
+            continue;
+        }
+        int target = resolveTarget(b.target);
+        changes += target != b.target;
+        b.target = target;
+        if (b.exit == BasicBlock::Exit::BRANCH)
+        {
+            int falseTarget = resolveTarget(b.falseTarget);
+            changes += falseTarget != b.falseTarget;
+            b.falseTarget = falseTarget;
+            // Обе ветки ведут в один блок - условие больше не нужно
+            if (b.target == b.falseTarget)
+            {
+                b.exit = BasicBlock::Exit::JUMP;
+                b.targetFreq += b.falseTargetFreq;
+                b.falseTarget = -1;
+                b.falseTargetFreq = 0;
+                changes++;
+            }
+        }
+    }
+    if (changes > 0)
+    {
+        layoutOrder.clear();
+    }
+    return changes;
+}
+
+std::vector<bool> ControlFlowGraph::reachability() const
+{
+    std::vector<bool> reachable(blocks.size(), false);
+    std::vector<int> stack = {0};
+    reachable[0] = true;
+    while (!stack.empty())
+    {
+        const BasicBlock &b = blocks[stack.back()];
+        stack.pop_back();
+        if (b.exit == BasicBlock::Exit::RETURN)
+        {
+            continue;
+        }
+        int succ[2] = {b.target, b.exit == BasicBlock::Exit::BRANCH ? b.falseTarget : -1};
+        for (int s : succ)
+        {
+            if (s >= 0 && !reachable[s])
+            {
+                reachable[s] = true;
+                stack.push_back(s);
+            }
+        }
+    }
+    return reachable;
+}
+
+int ControlFlowGraph::removeUnreachable(const std::vector<bool> &reachable)
+{
+    int changes = 0;
+    for (size_t i = 0; i < blocks.size(); ++i)
+    {
+        if (!reachable[i] && !blocks[i].removed)
+        {
+            blocks[i].removed = true;
+            changes++;
+        }
+    }
+    if (changes > 0)
+    {
+        layoutOrder.clear();
+    }
+    return changes;
+}
+
+std::vector<int> ControlFlowGraph::predecessorCounts() const
+{
+    std::vector<int> preds(blocks.size(), 0);
+    for (const auto &b : blocks)
+    {
+        if (b.removed || b.exit == BasicBlock::Exit::RETURN)
+        {
+            continue;
+        }
+        preds[b.target]++;
+        if (b.exit == BasicBlock::Exit::BRANCH)
+        {
+            preds[b.falseTarget]++;
+        }
+    }
+    return preds;
+}
+
+int ControlFlowGraph::mergeBlocks(const std::vector<int> &preds)
+{
+    // Блок с единственным предшественником приклеиваем к нему. Дуги
+    // приклеенного блока переходят к предшественнику, так что число
+    // предшественников у остальных блоков не меняется
+    int changes = 0;
+    for (size_t i = 0; i < blocks.size(); ++i)
+    {
+        BasicBlock &b = blocks[i];
+        while (!b.removed && b.exit == BasicBlock::Exit::JUMP && b.target != 0 &&
+               b.target != static_cast<int>(i) && preds[b.target] == 1)
+        {
+            BasicBlock &next = blocks[b.target];
+            for (const auto &segment : next.segments)
+            {
+                b.segments.push_back({segment.offset + b.code.size(), segment.owner});
+            }
+            b.code += next.code;
+            b.exitOwner = next.exitOwner;
+            b.exit = next.exit;
+            b.target = next.target;
+            b.falseTarget = next.falseTarget;
+            b.targetFreq = next.targetFreq;
+            b.falseTargetFreq = next.falseTargetFreq;
+            next.removed = true;
+            changes++;
+        }
+    }
+    if (changes > 0)
+    {
+        layoutOrder.clear();
+    }
+    return changes;
+}
+
+std::vector<int> ControlFlowGraph::liveBlocksInOrder() const
+{
+    std::vector<int> live;
+    for (size_t i = 0; i < blocks.size(); ++i)
+    {
+        if (!blocks[i].removed)
+        {
+            live.push_back(static_cast<int>(i));
+        }
+    }
+    std::sort(live.begin(), live.end(),
+              [this](int a, int b) { return blocks[a].order < blocks[b].order; });
+    return live;
+}
+
+void ControlFlowGraph::keepSourceOrder()
+{
+    layoutOrder = liveBlocksInOrder();
+}
+
+int ControlFlowGraph::layout(bool bySize)
+{
+    // Живые блоки в исходном порядке
+    std::vector<int> live = liveBlocksInOrder();
+    std::vector<int> rank(blocks.size(), -1);
+    for (size_t i = 0; i < live.size(); ++i)
+    {
+        rank[live[i]] = static_cast<int>(i);
+    }
+
+    struct Edge
+    {
+        int from;
+        int to;
+        double weight;
+        bool jump;       // безусловный переход: склейка убирает инструкцию целиком
+        bool sourceNext; // в исходном порядке to идет сразу за from
+    };
+    // По размеру любая дуга, ставшая проходом, убирает из кода одну
+    // инструкцию перехода, поэтому веса дуг равны
+    std::vector<Edge> edges;
+    for (int id : live)
+    {
+        const BasicBlock &b = blocks[id];
+        double targetWeight = bySize ? 1 : b.targetFreq;
+        double falseWeight = bySize ? 1 : b.falseTargetFreq;
+        if (b.exit == BasicBlock::Exit::JUMP)
+        {
+            edges.push_back({id, b.target, targetWeight, true, rank[b.target] == rank[id] + 1});
+        }
+        else if (b.exit == BasicBlock::Exit::BRANCH)
+        {
+            edges.push_back({id, b.target, targetWeight, false, rank[b.target] == rank[id] + 1});
+            edges.push_back({id, b.falseTarget, falseWeight, false,
+                             rank[b.falseTarget] == rank[id] + 1});
+        }
+    }
+
+    // Жадная склейка цепочек (Pettis-Hansen): сначала самые частые дуги,
+    // при равенстве - безусловные переходы и исходный порядок
+    std::stable_sort(edges.begin(), edges.end(), [](const Edge &a, const Edge &b)
+                     {
+                         if (a.weight != b.weight)
+                             return a.weight > b.weight;
+                         if (a.jump != b.jump)
+                             return a.jump;
+                         return a.sourceNext && !b.sourceNext;
+                     });
+
+    std::vector<int> next(blocks.size(), -1);
+    std::vector<bool> isHead(blocks.size(), true);
+    std::vector<int> chain(blocks.size());
+    std::iota(chain.begin(), chain.end(), 0);
+    std::function<int(int)> findChain = [&](int id)
+    {
+        while (chain[id] != id)
+        {
+            chain[id] = chain[chain[id]];
+            id = chain[id];
+        }
+        return id;
+    };
+
+    int fallThroughs = 0;
+    for (const auto &e : edges)
+    {
+        if (next[e.from] != -1 || !isHead[e.to] || e.to == 0 ||
+            findChain(e.from) == findChain(e.to))
+        {
+            continue;
+        }
+        fallThroughs++;
+        next[e.from] = e.to;
+        isHead[e.to] = false;
+        chain[findChain(e.to)] = findChain(e.from);
+    }
+
+    // Цепочка входа первая, остальные - по исходному порядку
+    std::vector<std::pair<int, int>> heads; // (минимальный ранг, голова)
+    for (int id : live)
+    {
+        if (!isHead[id] || id == 0)
+        {
+            continue;
+        }
+        int minRank = rank[id];
+        for (int b = id; b != -1; b = next[b])
+        {
+            minRank = std::min(minRank, rank[b]);
+        }
+        heads.push_back({minRank, id});
+    }
+    std::sort(heads.begin(), heads.end());
+
+    layoutOrder.clear();
+    for (int b = 0; b != -1; b = next[b])
+    {
+        layoutOrder.push_back(b);
+    }
+    for (const auto &h : heads)
+    {
+        for (int b = h.second; b != -1; b = next[b])
+        {
+            layoutOrder.push_back(b);
+        }
+    }
+    return fallThroughs;
+}
+
+std::vector<ExitInstruction> ControlFlowGraph::exitInstructions(size_t pos) const
+{
+    // Переход на следующий по размещению блок не нужен
+    auto isNext = [this, pos](int target)
+    {
+        return pos + 1 < layoutOrder.size() && layoutOrder[pos + 1] == target;
+    };
+    auto label = [this](int id) { return labels.empty() ? std::string() : labels[id]; };
+
+    std::vector<ExitInstruction> exits;
+    const BasicBlock &b = blocks[layoutOrder[pos]];
+    if (b.exit == BasicBlock::Exit::JUMP)
+    {
+        if (!isNext(b.target))
+        {
+            exits.push_back({"    j " + label(b.target) + "\n", b.targetFreq, b.targetFreq});
+        }
+    }
+    else if (b.exit == BasicBlock::Exit::BRANCH)
+    {
+        double total = b.targetFreq + b.falseTargetFreq;
+        if (isNext(b.target))
+        {
+            exits.push_back({"    beqz a0, " + label(b.falseTarget) + "\n", total, b.falseTargetFreq});
+        }
+        else
+        {
+            exits.push_back({"    bnez a0, " + label(b.target) + "\n", total, b.targetFreq});
+            if (!isNext(b.falseTarget))
+            {
+                exits.push_back({"    j " + label(b.falseTarget) + "\n", b.falseTargetFreq,
+                                 b.falseTargetFreq});
+            }
+        }
+    }
+    return exits;
+}
+
+void ControlFlowGraph::emit(std::ostream &out, const std::function<std::string()> &newLabel)
+{
+    // Метка нужна блоку, на который есть переход не из предыдущего блока
+    std::vector<bool> needsLabel(blocks.size(), false);
+    for (size_t pos = 0; pos < layoutOrder.size(); ++pos)
+    {
+        const BasicBlock &b = blocks[layoutOrder[pos]];
+        auto isNext = [this, pos](int target)
+        {
+            return pos + 1 < layoutOrder.size() && layoutOrder[pos + 1] == target;
+        };
+        if (b.exit == BasicBlock::Exit::JUMP)
+        {
+            needsLabel[b.target] = needsLabel[b.target] || !isNext(b.target);
+        }
+        else if (b.exit == BasicBlock::Exit::BRANCH)
+        {
+            needsLabel[b.target] = needsLabel[b.target] || !isNext(b.target);
+            needsLabel[b.falseTarget] = needsLabel[b.falseTarget] || !isNext(b.falseTarget);
+        }
+    }
+
+    labels.assign(blocks.size(), "");
+    for (int id : layoutOrder)
+    {
+        if (needsLabel[id])
+        {
+            labels[id] = newLabel();
+        }
+    }
+
+    for (size_t pos = 0; pos < layoutOrder.size(); ++pos)
+    {
+        int id = layoutOrder[pos];
+        if (needsLabel[id])
+        {
+            out << labels[id] << ":\n";
+        }
+        out << blocks[id].code;
+        for (const auto &exit : exitInstructions(pos))
+        {
+            out << exit.text;
+        }
+    }
+}
@@ -0,0 +1,94 @@
+#ifndef CFG_HPP
+#define CFG_HPP
+
+#include "ast.hpp"
+#include <functional>
+#include <ostream>
+#include <string>
+#include <vector>
+
+// Участок кода блока, созданный одним оператором исходной программы
+// (NO_NODE - пролог и завершение программы)
+struct CodeSegment
+{
+    size_t offset; // начало участка в code
+    NodeId owner;
+};
+
+// Инструкция перехода, которую emit ставит в конце блока
+struct ExitInstruction
+{
+    std::string text;
+    double executions; // сколько раз выполняется
+    double taken;      // сколько раз переход происходит
+};
+
+// Базовый блок: линейный код и переход в конце
+struct BasicBlock
+{
+    enum class Exit
+    {
+        JUMP,   // безусловный переход на target
+        BRANCH, // a0 != 0 -> target, иначе -> falseTarget
+        RETURN  // конец программы, переходов нет
+    };
+
+    std::string code;
+    std::vector<CodeSegment> segments;
+    NodeId exitOwner = NO_NODE; // оператор, которому принадлежит переход
+    Exit exit = Exit::RETURN;
+    int target = -1;
+    int falseTarget = -1;
+    double targetFreq = 0;      // сколько раз выполняется переход на target
+    double falseTargetFreq = 0; // сколько раз выполняется переход на falseTarget
+    double freq = 0;            // сколько раз выполняется блок
+    int order = -1;             // позиция блока в исходном порядке
+    bool removed = false;
+};
+
+// Граф потока управления программы. Блок 0 - точка входа.
+class ControlFlowGraph
+{
+private:
+    std::vector<BasicBlock> blocks;
+    std::vector<int> layoutOrder;
+    std::vector<std::string> labels; // метки блоков после emit
+    int placedCount;
+
+    int resolveTarget(int id) const;
+    std::vector<int> liveBlocksInOrder() const;
+
+public:
+    ControlFlowGraph() : placedCount(0) {}
+
+    int createBlock();
+    int size() const { return static_cast<int>(blocks.size()); }
+    BasicBlock &block(int id) { return blocks[id]; }
+    const BasicBlock &block(int id) const { return blocks[id]; }
+
+    // Блок начинает заполняться: фиксируем его место в исходном порядке
+    void placeBlock(int id, double freq);
+
+    // Анализы для проходов (результаты кэширует менеджер проходов)
+    std::vector<bool> reachability() const;
+    std::vector<int> predecessorCounts() const;
+
+    // Проходы над графом; возвращают число изменений. Изменение графа
+    // сбрасывает размещение блоков
+    int threadJumps();                                      // переходы на переходы
+    int removeUnreachable(const std::vector<bool> &reachable);
+    int mergeBlocks(const std::vector<int> &predecessors);  // цепочки в один блок
+    // Порядок блоков с минимумом выполняемых переходов (bySize - с минимумом
+    // инструкций перехода в коде); возвращает число переходов проходом
+    int layout(bool bySize);
+    // Без layout блоки идут в исходном порядке
+    void keepSourceOrder();
+    // Вывод блоков; метки создаются только для блоков, на которые есть переход
+    void emit(std::ostream &out, const std::function<std::string()> &newLabel);
+
+    // Размещение после layout и переходы в конце блока на позиции pos
+    const std::vector<int> &placement() const { return layoutOrder; }
+    std::vector<ExitInstruction> exitInstructions(size_t pos) const;
+};
+
+#endif // CFG_HPP
@@ -1,6 +1,44 @@
 #include "codegen.hpp"
+#include "runtime.hpp"
 #include <iostream>
 #include <sstream>
+#include <fstream>
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <thread>
+
+// Заголовок дампа профиля: "RVPF" в little-endian, затем число счетчиков
+static const uint32_t PROFILE_MAGIC = 0x46505652;
+
+// Параллельная генерация: операторов верхнего уровня на фрагмент не меньше,
+// фрагментов на поток - несколько, чтобы длинный цикл не задерживал остальных
+static const size_t MIN_STATEMENTS_PER_CHUNK = 64;
+static const size_t CHUNKS_PER_THREAD = 4;
+
+// Регистры, в которые можно поместить переменные (s0 оставляем под fp)
+static const char *const SAVED_REGISTERS[] = {
+    "s1", "s2", "s3", "s4", "s5", "s6", "s7", "s8", "s9", "s10", "s11"};
+static const size_t SAVED_REGISTER_COUNT = sizeof(SAVED_REGISTERS) / sizeof(SAVED_REGISTERS[0]);
+
+// Регистры для общих подвыражений: генератор их не использует,
+// а системные вызовы сохраняют все регистры, кроме a0
+static const char *const CSE_REGISTERS[] = {"t3", "t4", "t5", "t6", "a3", "a4", "a5", "a6"};
+static const size_t CSE_REGISTER_COUNT = sizeof(CSE_REGISTERS) / sizeof(CSE_REGISTERS[0]);
+
+CodeGenerator::CodeGenerator(const CodeGenerator &parent, CostModel *chunkCostModel)
+    : output(parent.output), resolved(parent), ast(parent.ast), currentStatement(NO_NODE),
+      stackOffset(0), spillSlots(0), spillDepth(0),
+      labelCounter(0), stringCounter(0), usesRuntime(false),
+      profileGenerate(parent.profileGenerate), profileUse(parent.profileUse),
+      profileCounterCount(0), currentFreq(1.0), loopTripEstimate(parent.loopTripEstimate),
+      loopDepth(0), costModel(chunkCostModel), threadCount(1), cseEnabled(false),
+      precomputeSteps(0), precomputed(false), precomputeStepsUsed(0)
+{
+    // Блок 0 уже размещен основным генератором, фрагмент его продолжает
+    currentBlock = cfg.createBlock();
+    markSegment();
+}
 
 std::string CodeGenerator::getNewLabel()
 {
@@ -30,17 +68,370 @@ void CodeGenerator::allocateVariable(const std::string &name)
 
 int CodeGenerator::getVariableOffset(const std::string &name)
 {
-    auto it = variables.find(name);
-    if (it != variables.end())
+    auto it = resolved.variables.find(name);
+    if (it != resolved.variables.end())
     {
         return it->second;
     }
     return 0; // Ошибка: переменная не найдена
 }
 
+bool CodeGenerator::loadProfile(const std::string &path)
+{
+    std::ifstream in(path, std::ios::binary);
+    if (!in)
+    {
+        return false;
+    }
+
+    uint32_t header[2];
+    if (!in.read(reinterpret_cast<char *>(header), sizeof(header)) || header[0] != PROFILE_MAGIC)
+    {
+        return false;
+    }
+
+    // Число счетчиков из заголовка сверяем с размером файла до выделения
+    // памяти: обрезанный или испорченный профиль - ошибка чтения
+    std::streampos countersStart = in.tellg();
+    in.seekg(0, std::ios::end);
+    std::streamoff countersSize = in.tellg() - countersStart;
+    in.seekg(countersStart);
+    if (!in || static_cast<uint64_t>(countersSize) != uint64_t(header[1]) * sizeof(uint32_t))
+    {
+        return false;
+    }
+
+    profileCounts.assign(header[1], 0);
+    if (header[1] > 0 &&
+        !in.read(reinterpret_cast<char *>(profileCounts.data()), header[1] * sizeof(uint32_t)))
+    {
+        profileCounts.clear();
+        return false;
+    }
+
+    profileUse = true;
+    return true;
+}
+
+double CodeGenerator::getCount(NodeId id, int index) const
+{
+    auto it = resolved.profileCounters.find(id);
+    if (it == resolved.profileCounters.end())
+    {
+        return 0;
+    }
+    size_t counter = it->second + index;
+    return counter < resolved.profileCounts.size() ? resolved.profileCounts[counter] : 0;
+}
+
+void CodeGenerator::registerPasses()
+{
+    passes.addAnalysis(Analysis::VALUE_NUMBERING, "value-numbering", [this]()
+                       {
+                           valueNumbering = ValueNumbering();
+                           valueNumbering.run(*ast);
+                       });
+    passes.addAnalysis(Analysis::REACHABILITY, "reachability",
+                       [this]() { reachableBlocks = cfg.reachability(); });
+    passes.addAnalysis(Analysis::PREDECESSORS, "predecessors",
+                       [this]() { blockPredecessors = cfg.predecessorCounts(); });
+
+    passes.addPass("promote", PassStage::AST, {}, {}, "variables in registers",
+                   [this]() { return promoteVariables(); });
+    passes.addPass("cse", PassStage::AST, {Analysis::VALUE_NUMBERING}, {}, "expressions reused",
+                   [this]() { return enableCse(); });
+    passes.addPass("thread-jumps", PassStage::CFG, {},
+                   {Analysis::REACHABILITY, Analysis::PREDECESSORS}, "edges retargeted",
+                   [this]() { return cfg.threadJumps(); });
+    passes.addPass("remove-unreachable", PassStage::CFG, {Analysis::REACHABILITY},
+                   {Analysis::PREDECESSORS}, "blocks removed",
+                   [this]() { return cfg.removeUnreachable(reachableBlocks); });
+    passes.addPass("merge-blocks", PassStage::CFG, {Analysis::PREDECESSORS}, {}, "blocks merged",
+                   [this]() { return cfg.mergeBlocks(blockPredecessors); });
+    passes.addPass("layout", PassStage::CFG, {}, {}, "fall-through edges",
+                   [this]() { return cfg.layout(passes.forSize()); });
+    passes.setLevel("-O2");
+}
+
+int CodeGenerator::promoteVariables()
+{
+    // Самые используемые переменные получают регистры s1-s11; для -Os
+    // важнее число обращений в тексте: каждое - это lw или sw в коде
+    std::vector<std::pair<double, std::string>> candidates;
+    for (const auto &name : declaredVariables)
+    {
+        auto it = variableUses.find(name);
+        double weight = 0;
+        if (it != variableUses.end())
+        {
+            weight = passes.forSize() ? it->second.references : it->second.loads + it->second.stores;
+        }
+        if (weight > 0)
+        {
+            candidates.push_back({weight, name});
+        }
+    }
+    std::stable_sort(candidates.begin(), candidates.end(),
+                     [](const std::pair<double, std::string> &a, const std::pair<double, std::string> &b)
+                     {
+                         return a.first > b.first;
+                     });
+
+    for (size_t i = 0; i < candidates.size() && i < SAVED_REGISTER_COUNT; ++i)
+    {
+        variableRegisters[candidates[i].second] = SAVED_REGISTERS[i];
+    }
+    return static_cast<int>(variableRegisters.size());
+}
+
+void CodeGenerator::allocateStack()
+{
+    // Слоты временных значений - ближе к s0, за ними переменные в порядке объявления
+    stackOffset = spillSlots * 4;
+    for (const auto &name : declaredVariables)
+    {
+        if (!variableRegisters.count(name))
+        {
+            allocateVariable(name);
+        }
+    }
+}
+
+void CodeGenerator::printPromotionReport(std::ostream &out) const
+{
+    if (precomputed)
+    {
+        out << "No variables: output computed at compile time\n";
+        return;
+    }
+    out << "Variable access estimate: "
+        << (profileUse ? "profile counts"
+                       : "static, x" + std::to_string(static_cast<long long>(loopTripEstimate)) +
+                             " per loop level, 1/2 per if arm")
+        << (passes.forSize() ? "; registers chosen by reference count (-Os)" : "") << "\n";
+
+    double savedLoads = 0;
+    double savedStores = 0;
+    size_t promoted = 0;
+    for (const auto &name : declaredVariables)
+    {
+        auto use = variableUses.find(name);
+        double loads = use != variableUses.end() ? use->second.loads : 0;
+        double stores = use != variableUses.end() ? use->second.stores : 0;
+        auto reg = variableRegisters.find(name);
+
+        out << "  " << name << ": ";
+        if (reg != variableRegisters.end())
+        {
+            out << reg->second;
+            savedLoads += loads;
+            savedStores += stores;
+            ++promoted;
+        }
+        else
+        {
+            out << "stack -" << variables.at(name) << "(s0)";
+        }
+        out << ", loads " << loads << ", stores " << stores << "\n";
+    }
+    out << "Promoted " << promoted << " of " << declaredVariables.size()
+        << " variables; estimated loads saved: " << savedLoads
+        << ", stores saved: " << savedStores << "\n";
+}
+
+int CodeGenerator::enableCse()
+{
+    assignCseRegisters();
+    cseEnabled = true;
+
+    // Повторные вычисления, которые заменит чтение регистра или переменной
+    int reused = 0;
+    for (const auto &entry : valueNumbering.actions())
+    {
+        if (entry.second.kind != CseAction::Kind::SAVE && findCse(entry.first))
+        {
+            reused++;
+        }
+    }
+    return reused;
+}
+
+void CodeGenerator::assignCseRegisters()
+{
+    // Линейное распределение по интервалам жизни; значение, которому
+    // не хватило регистра, просто вычисляется заново. Временные значения
+    // создаются при первом повторе, поэтому их обходим по началу интервала
+    const auto &temps = valueNumbering.temps();
+    cseRegisters.assign(temps.size(), "");
+    std::vector<int> order(temps.size());
+    for (size_t i = 0; i < order.size(); ++i)
+    {
+        order[i] = static_cast<int>(i);
+    }
+    std::stable_sort(order.begin(), order.end(),
+                     [&temps](int a, int b) { return temps[a].start < temps[b].start; });
+    std::vector<int> active;
+    for (int i : order)
+    {
+        active.erase(std::remove_if(active.begin(), active.end(),
+                                    [&](int t) { return temps[t].end < temps[i].start; }),
+                     active.end());
+
+        std::vector<bool> busy(CSE_REGISTER_COUNT, false);
+        for (int t : active)
+        {
+            for (size_t r = 0; r < CSE_REGISTER_COUNT; ++r)
+            {
+                if (cseRegisters[t] == CSE_REGISTERS[r])
+                {
+                    busy[r] = true;
+                }
+            }
+        }
+        for (size_t r = 0; r < CSE_REGISTER_COUNT; ++r)
+        {
+            if (!busy[r])
+            {
+                cseRegisters[i] = CSE_REGISTERS[r];
+                active.push_back(i);
+                break;
+            }
+        }
+    }
+}
+
+const CseAction *CodeGenerator::findCse(NodeId id) const
+{
+    if (!resolved.cseEnabled)
+    {
+        return nullptr;
+    }
+    const auto &actions = resolved.valueNumbering.actions();
+    auto it = actions.find(id);
+    if (it == actions.end())
+    {
+        return nullptr;
+    }
+    const CseAction &action = it->second;
+    if (action.kind != CseAction::Kind::REUSE_VARIABLE &&
+        resolved.cseRegisters[action.temp].empty())
+    {
+        return nullptr;
+    }
+    return &action;
+}
+
+bool CodeGenerator::emitCseReuse(NodeId id)
+{
+    const CseAction *action = findCse(id);
+    if (!action || action->kind == CseAction::Kind::SAVE)
+    {
+        return false;
+    }
+    if (action->kind == CseAction::Kind::REUSE_VARIABLE)
+    {
+        emitLoadVariable(action->variable);
+    }
+    else
+    {
+        code << "    mv a0, " << resolved.cseRegisters[action->temp]
+             << "   # reuse common subexpression\n";
+    }
+    return true;
+}
+
+void CodeGenerator::emitCseSave(NodeId id)
+{
+    const CseAction *action = findCse(id);
+    if (action && action->kind == CseAction::Kind::SAVE)
+    {
+        code << "    mv " << resolved.cseRegisters[action->temp]
+             << ", a0   # save common subexpression\n";
+    }
+}
+
+std::string CodeGenerator::frameSlot(int offset)
+{
+    // Смещение больше 2048 не помещается в 12 бит: адрес считается в t0
+    if (offset <= 2048)
+    {
+        return "-" + std::to_string(offset) + "(s0)";
+    }
+    code << "    li t0, -" << offset << "\n";
+    code << "    add t0, t0, s0\n";
+    return "0(t0)";
+}
+
+void CodeGenerator::emitLoadVariable(const std::string &name)
+{
+    auto it = resolved.variableRegisters.find(name);
+    if (it != resolved.variableRegisters.end())
+    {
+        code << "    mv a0, " << it->second << "   # load " << name << "\n";
+        return;
+    }
+    std::string slot = frameSlot(getVariableOffset(name));
+    code << "    lw a0, " << slot << "   # load " << name << "\n";
+}
+
+void CodeGenerator::emitStoreVariable(const std::string &name)
+{
+    auto it = resolved.variableRegisters.find(name);
+    if (it != resolved.variableRegisters.end())
+    {
+        code << "    mv " << it->second << ", a0   # " << name << " = a0\n";
+        return;
+    }
+    std::string slot = frameSlot(getVariableOffset(name));
+    code << "    sw a0, " << slot << "   # " << name << " = a0\n";
+}
+
+void CodeGenerator::emitCounterIncrement(int counter)
+{
+    code << "    la t0, __prof_counters   # profile counter " << counter << "\n";
+    code << "    lw t1, " << counter * 4 << "(t0)\n";
+    code << "    addi t1, t1, 1\n";
+    code << "    sw t1, " << counter * 4 << "(t0)\n";
+}
+
+void CodeGenerator::emitProfileDump()
+{
+    code << "    # Dump profile counters\n";
+    code << "    li a7, 64     # write system call\n";
+    code << "    li a0, 2      # stderr\n";
+    code << "    la a1, __prof_data\n";
+    code << "    li a2, " << 8 + profileCounterCount * 4 << "\n";
+    code << "    ecall\n";
+}
+
+VarType CodeGenerator::expressionType(NodeId id) const
+{
+    // Строкой может быть только литерал или строковая переменная
+    if (ast->kind(id) == NodeKind::STRING_LITERAL)
+    {
+        return VarType::STRING;
+    }
+    if (ast->kind(id) == NodeKind::IDENTIFIER)
+    {
+        auto it = resolved.variableTypes.find(ast->name(id));
+        if (it != resolved.variableTypes.end())
+        {
+            return it->second;
+        }
+    }
+    return VarType::INT;
+}
+
 void CodeGenerator::genDataSection()
 {
     output << ".data\n";
+    // Счетчики профиля: заголовок и массив, который сбрасывается при выходе
+    if (profileGenerate)
+    {
+        output << ".align 2\n";
+        output << "__prof_data: .word " << PROFILE_MAGIC << ", " << profileCounterCount << "\n";
+        output << "__prof_counters: .space " << profileCounterCount * 4 << "\n";
+    }
     // Генерируем строковые литералы
     for (const auto &pair : stringLiterals)
     {
@@ -50,7 +441,10 @@ void CodeGenerator::genDataSection()
         {
             str = str.substr(1, str.length() - 2);
         }
-        output << pair.second << ": .string \"" << str << "\"\n";
+        // Строка с длиной: так ее печатает __rt_print_str
+        output << ".align 2\n";
+        output << pair.second << ": .word " << decodedStringLength(str) << "\n";
+        output << "    .ascii \"" << str << "\"\n";
     }
     output << "\n";
 }
@@ -61,274 +455,791 @@ void CodeGenerator::genTextSection()
     output << ".globl _start\n";
     output << "_start:\n";
 
-    // Настройка стека
+    // Кадр выделяется один раз: слоты и переменные адресуются от s0 (верх
+    // кадра), sp внутри программы не меняется и выровнен на 16 байт
     if (stackOffset > 0)
     {
-        output << "    addi sp, sp, -" << stackOffset << "\n";
+        int frameSize = (stackOffset + 15) / 16 * 16;
+        code << "    mv s0, sp\n";
+        if (frameSize <= 2048)
+        {
+            code << "    addi sp, sp, -" << frameSize << "\n";
+        }
+        else
+        {
+            code << "    li t0, " << frameSize << "\n";
+            code << "    sub sp, sp, t0\n";
+        }
     }
 }
 
-void CodeGenerator::generateCode(const ProgramNode &program)
+void CodeGenerator::startBlock(int id)
 {
-    // Первый проход: собираем все переменные и строковые литералы
-    collectInfo(program);
+    currentBlock = id;
+    cfg.placeBlock(id, currentFreq);
+    markSegment();
+}
+
+BasicBlock &CodeGenerator::finishBlock()
+{
+    BasicBlock &b = cfg.block(currentBlock);
+    b.code = code.str();
+    b.segments = std::move(segments);
+    b.exitOwner = currentStatement;
+    code.str("");
+    segments.clear();
+    return b;
+}
+
+void CodeGenerator::endWithJump(int target)
+{
+    BasicBlock &b = finishBlock();
+    b.exit = BasicBlock::Exit::JUMP;
+    b.target = target;
+    b.targetFreq = currentFreq;
+}
+
+void CodeGenerator::endWithBranch(int trueTarget, int falseTarget, double trueFreq, double falseFreq)
+{
+    BasicBlock &b = finishBlock();
+    b.exit = BasicBlock::Exit::BRANCH;
+    b.target = trueTarget;
+    b.falseTarget = falseTarget;
+    b.targetFreq = trueFreq;
+    b.falseTargetFreq = falseFreq;
+}
+
+void CodeGenerator::appendCode(const std::string &text, const std::vector<CodeSegment> &parts)
+{
+    size_t base = static_cast<size_t>(code.tellp());
+    for (const auto &part : parts)
+    {
+        segments.push_back({base + part.offset, part.owner});
+    }
+    code << text;
+}
+
+void CodeGenerator::markSegment()
+{
+    // Дальнейший код блока относится к текущему оператору
+    size_t offset = static_cast<size_t>(code.tellp());
+    if (!segments.empty() && segments.back().offset == offset)
+    {
+        segments.back().owner = currentStatement;
+        return;
+    }
+    segments.push_back({offset, currentStatement});
+}
+
+NodeId CodeGenerator::enterStatement(NodeId id)
+{
+    NodeId outer = currentStatement;
+    currentStatement = id;
+    markSegment();
+    if (costModel)
+    {
+        costModel->addStatement(id, loopDepth, currentFreq);
+    }
+    return outer;
+}
+
+void CodeGenerator::leaveStatement(NodeId outer)
+{
+    currentStatement = outer;
+    markSegment();
+}
+
+void CodeGenerator::generateCode(const Ast &tree)
+{
+    ast = &tree;
+
+    // Переменные, строки и частоты обращений нужны при любом наборе проходов
+    passes.runPhase("collect", [this]() { collectInfo(); });
+
+    // Программа без ввода, завершившаяся при компиляции, заменяется своим выводом
+    if (precomputeSteps > 0)
+    {
+        passes.runPhase("precompute", [this]() { precompute(); });
+    }
+
+    // Проходы над AST: переменные в регистрах, общие подвыражения
+    if (!precomputed)
+    {
+        passes.run(PassStage::AST);
+    }
+
+    passes.runPhase("lower", [this]() { lowerProgram(); });
+
+    // Проходы над графом: чистка графа и порядок блоков по частотам переходов
+    passes.run(PassStage::CFG);
+
+    passes.runPhase("emit", [this]() { emitProgram(); });
+
+    if (costModel)
+    {
+        costModel->analyze(cfg, *ast, loopTripEstimate, profileUse);
+    }
+}
+
+void CodeGenerator::precompute()
+{
+    // Инструментированная программа должна выполниться, чтобы записать профиль
+    if (profileGenerate)
+    {
+        precomputeFailure = "-fprofile-generate needs the instrumented program";
+        return;
+    }
+
+    ProgramEvaluator evaluator(*ast, variableTypes, precomputeSteps, PRECOMPUTE_OUTPUT_LIMIT);
+    precomputed = evaluator.run();
+    precomputeStepsUsed = evaluator.steps();
+    if (!precomputed)
+    {
+        precomputeFailure = evaluator.reason();
+        return;
+    }
+    precomputedOutput = evaluator.output();
+    usesRuntime = false;
+}
+
+void CodeGenerator::printPrecomputeReport(std::ostream &out) const
+{
+    if (precomputed)
+    {
+        out << "Program finished at compile time in " << precomputeStepsUsed << " steps; ";
+        if (precomputedOutput.empty())
+        {
+            out << "no output\n";
+        }
+        else
+        {
+            out << precomputedOutput.size() << " bytes of output written by one system call\n";
+        }
+    }
+    else
+    {
+        out << "Normal code generation: " << precomputeFailure << "\n";
+    }
+}
+
+void CodeGenerator::lowerPrecomputed()
+{
+    // Вывод - в секции данных; байты вне печатных ASCII - восьмеричными escape
+    output << ".data\n";
+    const size_t bytesPerLine = 64;
+    for (size_t start = 0; start < precomputedOutput.size(); start += bytesPerLine)
+    {
+        output << (start == 0 ? "__precomputed_output:\n" : "") << "    .ascii \"";
+        size_t end = std::min(start + bytesPerLine, precomputedOutput.size());
+        for (size_t i = start; i < end; ++i)
+        {
+            unsigned char c = static_cast<unsigned char>(precomputedOutput[i]);
+            if (c == '"' || c == '\\')
+            {
+                output << '\\' << c;
+            }
+            else if (c == '\n')
+            {
+                output << "\\n";
+            }
+            else if (c >= 32 && c < 127)
+            {
+                output << c;
+            }
+            else
+            {
+                output << '\\' << static_cast<char>('0' + (c >> 6))
+                       << static_cast<char>('0' + ((c >> 3) & 7))
+                       << static_cast<char>('0' + (c & 7));
+            }
+        }
+        output << "\"\n";
+    }
+    output << "\n";
+
+    startBlock(cfg.createBlock());
+    output << ".text\n";
+    output << ".globl _start\n";
+    output << "_start:\n";
+    if (!precomputedOutput.empty())
+    {
+        code << "    # Output computed at compile time\n";
+        code << "    li a7, 64     # write system call\n";
+        code << "    li a0, 1      # stdout\n";
+        code << "    la a1, __precomputed_output\n";
+        code << "    li a2, " << precomputedOutput.size() << "\n";
+        code << "    ecall\n";
+    }
+    code << "    # Exit program\n";
+    code << "    li a7, 93     # exit system call\n";
+    code << "    li a0, 0      # exit status\n";
+    code << "    ecall\n";
+    finishBlock();
+}
+
+void CodeGenerator::lowerProgram()
+{
+    if (precomputed)
+    {
+        lowerPrecomputed();
+        return;
+    }
+
+    // Переменные без регистра - в стеке
+    allocateStack();
 
     // Генерируем секцию данных
     genDataSection();
 
+    // Код строится по базовым блокам, блок 0 - точка входа
+    startBlock(cfg.createBlock());
+
     // Генерируем секцию кода
     genTextSection();
 
     // Генерируем код для всех операторов
-    for (const auto &stmt : program.statements)
+    lowerStatements();
+
+    if (profileGenerate)
     {
-        stmt->accept(*this);
+        emitProfileDump();
+    }
+
+    // Выводим то, что осталось в буфере
+    if (usesRuntime)
+    {
+        code << "    # Flush output buffer\n";
+        code << "    jal t2, __rt_flush\n";
     }
 
     // Завершение программы
-    output << "    # Exit program\n";
-    output << "    li a7, 93     # exit system call\n";
-    output << "    li a0, 0      # exit status\n";
-    output << "    ecall\n";
+    code << "    # Exit program\n";
+    code << "    li a7, 93     # exit system call\n";
+    code << "    li a0, 0      # exit status\n";
+    code << "    ecall\n";
+    finishBlock();
 }
 
-void CodeGenerator::collectInfo(const ProgramNode &program)
+void CodeGenerator::emitProgram()
 {
-    for (const auto &stmt : program.statements)
+    // Без прохода layout блоки выводятся в исходном порядке
+    if (cfg.placement().empty())
+    {
+        cfg.keepSourceOrder();
+    }
+    cfg.emit(output, [this]() { return getNewLabel(); });
+
+    if (usesRuntime)
     {
-        collectInfoFromNode(*stmt);
+        emitRuntimeText(output);
+        emitRuntimeData(output);
     }
 }
 
-void CodeGenerator::collectInfoFromNode(const ASTNode &node)
+void CodeGenerator::lowerStatements()
 {
-    // Здесь мы используем visitor pattern для сбора информации
-    // Но нам нужен отдельный метод для этого
-    if (auto varDecl = dynamic_cast<const VarDeclNode *>(&node))
+    NodeList statements = ast->statements(ast->root());
+    size_t threads = threadCount > 0 ? static_cast<size_t>(threadCount)
+                                     : std::max(1u, std::thread::hardware_concurrency());
+
+    // Небольшую программу быстрее сгенерировать в одном потоке
+    if (threads <= 1 || statements.size() < 2 * MIN_STATEMENTS_PER_CHUNK)
+    {
+        for (NodeId stmt : statements)
+        {
+            visit(stmt);
+        }
+        return;
+    }
+
+    // Фрагменты - непрерывные отрезки операторов, каждый со своим графом;
+    // потоки разбирают их по очереди
+    size_t chunkCount =
+        std::min(threads * CHUNKS_PER_THREAD, statements.size() / MIN_STATEMENTS_PER_CHUNK);
+    std::vector<std::unique_ptr<CostModel>> chunkCosts(chunkCount);
+    std::vector<std::unique_ptr<CodeGenerator>> chunks;
+    for (size_t c = 0; c < chunkCount; ++c)
+    {
+        if (costModel)
+        {
+            chunkCosts[c].reset(new CostModel());
+        }
+        chunks.emplace_back(new CodeGenerator(*this, chunkCosts[c].get()));
+    }
+
+    std::atomic<size_t> nextChunk(0);
+    auto lowerChunks = [&]()
+    {
+        for (size_t c = nextChunk++; c < chunkCount; c = nextChunk++)
+        {
+            size_t begin = statements.size() * c / chunkCount;
+            size_t end = statements.size() * (c + 1) / chunkCount;
+            for (size_t i = begin; i < end; ++i)
+            {
+                chunks[c]->visit(statements[i]);
+            }
+        }
+    };
+    std::vector<std::thread> workers;
+    for (size_t t = 1; t < std::min(threads, chunkCount); ++t)
     {
-        allocateVariable(varDecl->name);
+        workers.emplace_back(lowerChunks);
     }
-    else if (auto block = dynamic_cast<const BlockNode *>(&node))
+    lowerChunks();
+    for (auto &worker : workers)
     {
-        for (const auto &stmt : block->statements)
+        worker.join();
+    }
+
+    // Склейка в исходном порядке: номера блоков и порядок размещения те же,
+    // что при последовательной генерации, а метки создаются только при выводе
+    for (size_t c = 0; c < chunkCount; ++c)
+    {
+        mergeChunk(*chunks[c]);
+        if (costModel)
         {
-            collectInfoFromNode(*stmt);
+            costModel->appendStatements(*chunkCosts[c]);
         }
     }
-    else if (auto assign = dynamic_cast<const AssignNode *>(&node))
+}
+
+void CodeGenerator::mergeChunk(CodeGenerator &chunk)
+{
+    // Блок 0 фрагмента - открытый блок, блок k > 0 получает номер base + k
+    int open = currentBlock;
+    int base = cfg.size() - 1;
+    auto globalId = [open, base](int local) { return local == 0 ? open : base + local; };
+    for (int k = 1; k < chunk.cfg.size(); ++k)
     {
-        collectInfoFromNode(*assign->expression);
+        cfg.createBlock();
     }
-    else if (auto print = dynamic_cast<const PrintNode *>(&node))
+
+    std::vector<int> placed;
+    for (int k = 1; k < chunk.cfg.size(); ++k)
     {
-        collectInfoFromNode(*print->expression);
+        placed.push_back(k);
     }
-    else if (auto ifNode = dynamic_cast<const IfNode *>(&node))
+    std::sort(placed.begin(), placed.end(),
+              [&chunk](int a, int b) { return chunk.cfg.block(a).order < chunk.cfg.block(b).order; });
+    for (int k : placed)
     {
-        collectInfoFromNode(*ifNode->condition);
-        collectInfoFromNode(*ifNode->thenStmt);
-        if (ifNode->elseStmt)
+        cfg.placeBlock(globalId(k), chunk.cfg.block(k).freq);
+    }
+
+    for (int k = 0; k < chunk.cfg.size(); ++k)
+    {
+        if (k == chunk.currentBlock)
         {
-            collectInfoFromNode(*ifNode->elseStmt);
+            continue; // блок еще открыт, его код - в chunk.code
         }
+        BasicBlock &from = chunk.cfg.block(k);
+        BasicBlock *to;
+        if (k == 0)
+        {
+            appendCode(from.code, from.segments);
+            to = &finishBlock();
+        }
+        else
+        {
+            to = &cfg.block(globalId(k));
+            to->code = std::move(from.code);
+            to->segments = std::move(from.segments);
+        }
+        to->exitOwner = from.exitOwner;
+        to->exit = from.exit;
+        to->target = from.target < 0 ? -1 : globalId(from.target);
+        to->falseTarget = from.falseTarget < 0 ? -1 : globalId(from.falseTarget);
+        to->targetFreq = from.targetFreq;
+        to->falseTargetFreq = from.falseTargetFreq;
     }
-    else if (auto whileNode = dynamic_cast<const WhileNode *>(&node))
+
+    currentBlock = globalId(chunk.currentBlock);
+    appendCode(chunk.code.str(), chunk.segments);
+}
+
+void CodeGenerator::collectInfo()
+{
+    for (NodeId stmt : ast->statements(ast->root()))
     {
-        collectInfoFromNode(*whileNode->condition);
-        collectInfoFromNode(*whileNode->body);
+        collectInfoFromNode(stmt, 1.0);
     }
-    else if (auto binOp = dynamic_cast<const BinaryOpNode *>(&node))
+
+    // Профиль от другой версии программы не используем: частоты
+    // собираем заново по статической оценке, иначе продвигать нечего
+    if (profileUse && profileCounts.size() != static_cast<size_t>(profileCounterCount))
     {
-        collectInfoFromNode(*binOp->left);
-        collectInfoFromNode(*binOp->right);
+        std::cerr << "Warning: profile has " << profileCounts.size() << " counters, program has "
+                  << profileCounterCount << "; ignoring profile\n";
+        profileUse = false;
+        profileCounts.clear();
+        variableUses.clear();
+        profileCounters.clear();
+        profileCounterCount = 0;
+        for (NodeId stmt : ast->statements(ast->root()))
+        {
+            collectInfoFromNode(stmt, 1.0);
+        }
     }
-    else if (auto unOp = dynamic_cast<const UnaryOpNode *>(&node))
+}
+
+int CodeGenerator::temporaryDepth(NodeId id) const
+{
+    // Левый операнд лежит в слоте, пока вычисляется правый
+    switch (ast->kind(id))
     {
-        collectInfoFromNode(*unOp->operand);
+    case NodeKind::BINARY_OP:
+        return std::max(temporaryDepth(ast->left(id)), 1 + temporaryDepth(ast->right(id)));
+    case NodeKind::UNARY_OP:
+        return temporaryDepth(ast->operand(id));
+    default:
+        return 0;
     }
-    else if (auto strLit = dynamic_cast<const StringLiteralNode *>(&node))
+}
+
+void CodeGenerator::collectInfoFromNode(NodeId id, double freq)
+{
+    // freq - сколько раз выполняется узел (по профилю или по статической оценке)
+    switch (ast->kind(id))
+    {
+    case NodeKind::VAR_DECL:
+        // Место в стеке выделяется после выбора переменных для регистров
+        if (!variableTypes.count(ast->name(id)))
+        {
+            declaredVariables.push_back(ast->name(id));
+        }
+        variableTypes[ast->name(id)] = ast->varType(id);
+        break;
+    case NodeKind::PROGRAM:
+    case NodeKind::BLOCK:
+        for (NodeId stmt : ast->statements(id))
+        {
+            collectInfoFromNode(stmt, freq);
+        }
+        break;
+    case NodeKind::ASSIGN:
+        spillSlots = std::max(spillSlots, temporaryDepth(ast->expression(id)));
+        variableUses[ast->name(id)].stores += freq;
+        variableUses[ast->name(id)].references++;
+        collectInfoFromNode(ast->expression(id), freq);
+        break;
+    case NodeKind::PRINT:
+        spillSlots = std::max(spillSlots, temporaryDepth(ast->expression(id)));
+        usesRuntime = true;
+        collectInfoFromNode(ast->expression(id), freq);
+        break;
+    case NodeKind::IF:
+        // Счетчики: then-ветка, else-ветка
+        profileCounters[id] = profileCounterCount;
+        profileCounterCount += 2;
+
+        spillSlots = std::max(spillSlots, temporaryDepth(ast->condition(id)));
+
+        // Без профиля - та же оценка, что и при размещении блоков
+        collectInfoFromNode(ast->condition(id), freq);
+        collectInfoFromNode(ast->thenStmt(id), profileUse ? getCount(id, 0) : freq * 0.5);
+        if (ast->elseStmt(id) != NO_NODE)
+        {
+            collectInfoFromNode(ast->elseStmt(id), profileUse ? getCount(id, 1) : freq * 0.5);
+        }
+        break;
+    case NodeKind::WHILE:
     {
-        getStringLabel(strLit->value);
+        // Счетчик: обратная дуга цикла
+        profileCounters[id] = profileCounterCount;
+        profileCounterCount += 1;
+
+        double bodyFreq = profileUse ? getCount(id, 0) : freq * loopTripEstimate;
+        spillSlots = std::max(spillSlots, temporaryDepth(ast->condition(id)));
+        collectInfoFromNode(ast->condition(id), freq + bodyFreq);
+        collectInfoFromNode(ast->body(id), bodyFreq);
+        break;
+    }
+    case NodeKind::BINARY_OP:
+        collectInfoFromNode(ast->left(id), freq);
+        collectInfoFromNode(ast->right(id), freq);
+        break;
+    case NodeKind::UNARY_OP:
+        collectInfoFromNode(ast->operand(id), freq);
+        break;
+    case NodeKind::STRING_LITERAL:
+        getStringLabel(ast->stringValue(id));
+        break;
+    case NodeKind::IDENTIFIER:
+        variableUses[ast->name(id)].loads += freq;
+        variableUses[ast->name(id)].references++;
+        break;
+    case NodeKind::INT_LITERAL:
+        break;
     }
 }
 
-void CodeGenerator::visit(const ProgramNode &node)
+void CodeGenerator::visit(NodeId id)
 {
-    // Этот метод вызывается для генерации кода программы
-    for (const auto &stmt : node.statements)
+    switch (ast->kind(id))
     {
-        stmt->accept(*this);
+    case NodeKind::PROGRAM:
+        lowerStatements();
+        break;
+    case NodeKind::VAR_DECL:
+        visitVarDecl(id);
+        break;
+    case NodeKind::ASSIGN:
+        visitAssign(id);
+        break;
+    case NodeKind::PRINT:
+        visitPrint(id);
+        break;
+    case NodeKind::IF:
+        visitIf(id);
+        break;
+    case NodeKind::WHILE:
+        visitWhile(id);
+        break;
+    case NodeKind::BLOCK:
+        visitBlock(id);
+        break;
+    case NodeKind::BINARY_OP:
+        visitBinaryOp(id);
+        break;
+    case NodeKind::UNARY_OP:
+        visitUnaryOp(id);
+        break;
+    case NodeKind::INT_LITERAL:
+        visitIntLiteral(id);
+        break;
+    case NodeKind::STRING_LITERAL:
+        visitStringLiteral(id);
+        break;
+    case NodeKind::IDENTIFIER:
+        visitIdentifier(id);
+        break;
     }
 }
 
-void CodeGenerator::visit(const VarDeclNode &node)
+void CodeGenerator::visitVarDecl(NodeId id)
 {
-    allocateVariable(node.name);
+    // Регистр или место в стеке назначены до генерации кода
+    leaveStatement(enterStatement(id));
 }
 
-void CodeGenerator::visit(const AssignNode &node)
+void CodeGenerator::visitAssign(NodeId id)
 {
+    NodeId outer = enterStatement(id);
+
     // Вычисляем выражение справа (результат в a0)
-    node.expression->accept(*this);
+    visit(ast->expression(id));
 
     // Сохраняем в переменную
-    int offset = getVariableOffset(node.variable);
-    output << "    sw a0, -" << offset << "(sp)   # " << node.variable << " = a0\n";
+    emitStoreVariable(ast->name(id));
+    leaveStatement(outer);
 }
 
-void CodeGenerator::visit(const PrintNode &node)
+void CodeGenerator::visitPrint(NodeId id)
 {
-    // Вычисляем выражение (результат в a0)
-    node.expression->accept(*this);
+    NodeId outer = enterStatement(id);
 
-    // Системный вызов для печати целого числа
-    output << "    # Print integer\n";
-    output << "    mv a1, a0     # move value to a1\n";
-    output << "    li a7, 1      # print int system call\n";
-    output << "    ecall\n";
+    // Вычисляем выражение (результат в a0)
+    visit(ast->expression(id));
 
-    // Печатаем перевод строки
-    output << "    li a7, 11     # print char system call\n";
-    output << "    li a0, 10     # newline character\n";
-    output << "    ecall\n";
+    // Печать в буфер среды выполнения, перевод строки добавляет она же
+    if (expressionType(ast->expression(id)) == VarType::STRING)
+    {
+        code << "    call __rt_print_str\n";
+    }
+    else
+    {
+        code << "    call __rt_print_int\n";
+    }
+    leaveStatement(outer);
 }
 
-void CodeGenerator::visit(const IfNode &node)
+void CodeGenerator::visitIf(NodeId id)
 {
-    std::string elseLabel = getNewLabel();
-    std::string endLabel = getNewLabel();
+    int thenBlock = cfg.createBlock();
+    int elseBlock = cfg.createBlock();
+    int endBlock = cfg.createBlock();
+    int counter = resolved.profileCounters.at(id);
+    NodeId outer = enterStatement(id);
 
-    // Вычисляем условие
-    node.condition->accept(*this);
+    // Без профиля считаем ветки равновероятными
+    double freq = currentFreq;
+    double thenFreq = profileUse ? getCount(id, 0) : freq * 0.5;
+    double elseFreq = profileUse ? getCount(id, 1) : freq * 0.5;
 
-    // Если результат 0 (false), переходим к else
-    output << "    beqz a0, " << elseLabel << "\n";
+    // Вычисляем условие; a0 != 0 - then, иначе else.
+    // Какая ветка пойдет проходом, решает размещение блоков
+    visit(ast->condition(id));
+    endWithBranch(thenBlock, elseBlock, thenFreq, elseFreq);
 
     // Генерируем код для then
-    node.thenStmt->accept(*this);
-    output << "    j " << endLabel << "\n";
+    currentFreq = thenFreq;
+    startBlock(thenBlock);
+    if (profileGenerate)
+    {
+        emitCounterIncrement(counter);
+    }
+    visit(ast->thenStmt(id));
+    endWithJump(endBlock);
 
-    // Генерируем код для else (если есть)
-    output << elseLabel << ":\n";
-    if (node.elseStmt)
+    // Генерируем код для else (если есть); пустой блок уберет simplify
+    currentFreq = elseFreq;
+    startBlock(elseBlock);
+    if (profileGenerate)
+    {
+        emitCounterIncrement(counter + 1);
+    }
+    if (ast->elseStmt(id) != NO_NODE)
     {
-        node.elseStmt->accept(*this);
+        visit(ast->elseStmt(id));
     }
+    endWithJump(endBlock);
 
-    output << endLabel << ":\n";
+    currentFreq = freq;
+    leaveStatement(outer);
+    startBlock(endBlock);
 }
 
-void CodeGenerator::visit(const WhileNode &node)
+void CodeGenerator::visitWhile(NodeId id)
 {
-    std::string startLabel = getNewLabel();
-    std::string endLabel = getNewLabel();
+    int condBlock = cfg.createBlock();
+    int bodyBlock = cfg.createBlock();
+    int endBlock = cfg.createBlock();
+    int counter = resolved.profileCounters.at(id);
+    NodeId outer = enterStatement(id);
 
-    output << startLabel << ":\n";
+    // Без профиля считаем, что цикл делает несколько итераций
+    double freq = currentFreq;
+    double bodyFreq = profileUse ? getCount(id, 0) : freq * loopTripEstimate;
 
-    // Вычисляем условие
-    node.condition->accept(*this);
+    endWithJump(condBlock);
 
-    // Если результат 0 (false), выходим из цикла
-    output << "    beqz a0, " << endLabel << "\n";
+    // Вычисляем условие; если результат 0 (false), выходим из цикла
+    currentFreq = freq + bodyFreq;
+    startBlock(condBlock);
+    visit(ast->condition(id));
+    endWithBranch(bodyBlock, endBlock, bodyFreq, freq);
 
-    // Генерируем тело цикла
-    node.body->accept(*this);
-
-    // Переходим к началу цикла
-    output << "    j " << startLabel << "\n";
+    // Генерируем тело цикла и переходим к условию
+    currentFreq = bodyFreq;
+    startBlock(bodyBlock);
+    ++loopDepth;
+    visit(ast->body(id));
+    --loopDepth;
+    if (profileGenerate)
+    {
+        emitCounterIncrement(counter);
+    }
+    endWithJump(condBlock);
 
-    output << endLabel << ":\n";
+    currentFreq = freq;
+    leaveStatement(outer);
+    startBlock(endBlock);
 }
 
-void CodeGenerator::visit(const BlockNode &node)
+void CodeGenerator::visitBlock(NodeId id)
 {
-    for (const auto &stmt : node.statements)
+    for (NodeId stmt : ast->statements(id))
     {
-        stmt->accept(*this);
+        visit(stmt);
     }
 }
 
-void CodeGenerator::visit(const BinaryOpNode &node)
+void CodeGenerator::visitBinaryOp(NodeId id)
 {
-    // Вычисляем левый операнд
-    node.left->accept(*this);
-    output << "    addi sp, sp, -4   # save left operand\n";
-    output << "    sw a0, 0(sp)\n";
+    // Значение уже вычислено раньше
+    if (emitCseReuse(id))
+    {
+        return;
+    }
+
+    // Вычисляем левый операнд и кладем его в слот своей глубины
+    visit(ast->left(id));
+    int offset = 4 * ++spillDepth;
+    std::string slot = frameSlot(offset);
+    code << "    sw a0, " << slot << "   # save left operand\n";
 
     // Вычисляем правый операнд
-    node.right->accept(*this);
-    output << "    mv t1, a0         # right operand to t1\n";
-    output << "    lw a0, 0(sp)      # restore left operand\n";
-    output << "    addi sp, sp, 4\n";
+    visit(ast->right(id));
+    --spillDepth;
+    code << "    mv t1, a0         # right operand to t1\n";
+    slot = frameSlot(offset);
+    code << "    lw a0, " << slot << "   # restore left operand\n";
 
     // Выполняем операцию
-    switch (node.op)
+    switch (ast->binOp(id))
     {
     case BinOpType::PLUS:
-        output << "    add a0, a0, t1\n";
+        code << "    add a0, a0, t1\n";
         break;
     case BinOpType::MINUS:
-        output << "    sub a0, a0, t1\n";
+        code << "    sub a0, a0, t1\n";
         break;
     case BinOpType::MUL:
-        output << "    mul a0, a0, t1\n";
+        code << "    mul a0, a0, t1\n";
         break;
     case BinOpType::DIV:
-        output << "    div a0, a0, t1\n";
+        code << "    div a0, a0, t1\n";
         break;
     case BinOpType::EQ:
-        output << "    sub a0, a0, t1\n";
-        output << "    seqz a0, a0\n";
+        code << "    sub a0, a0, t1\n";
+        code << "    seqz a0, a0\n";
         break;
     case BinOpType::NEQ:
-        output << "    sub a0, a0, t1\n";
-        output << "    snez a0, a0\n";
+        code << "    sub a0, a0, t1\n";
+        code << "    snez a0, a0\n";
         break;
     case BinOpType::LT:
-        output << "    slt a0, a0, t1\n";
+        code << "    slt a0, a0, t1\n";
         break;
     case BinOpType::LE:
-        output << "    slt t2, t1, a0\n";
-        output << "    xori a0, t2, 1\n";
+        code << "    slt t2, t1, a0\n";
+        code << "    xori a0, t2, 1\n";
         break;
     case BinOpType::GT:
-        output << "    slt a0, t1, a0\n";
+        code << "    slt a0, t1, a0\n";
         break;
     case BinOpType::GE:
-        output << "    slt t2, a0, t1\n";
-        output << "    xori a0, t2, 1\n";
+        code << "    slt t2, a0, t1\n";
+        code << "    xori a0, t2, 1\n";
         break;
     case BinOpType::AND:
-        output << "    and a0, a0, t1\n";
+        code << "    and a0, a0, t1\n";
         break;
     case BinOpType::OR:
-        output << "    or a0, a0, t1\n";
+        code << "    or a0, a0, t1\n";
         break;
     }
+
+    emitCseSave(id);
 }
 
-void CodeGenerator::visit(const UnaryOpNode &node)
+void CodeGenerator::visitUnaryOp(NodeId id)
 {
+    if (emitCseReuse(id))
+    {
+        return;
+    }
+
     // Вычисляем операнд
-    node.operand->accept(*this);
+    visit(ast->operand(id));
 
     // NOT operation: если a0 == 0, то результат 1, иначе 0
-    output << "    seqz a0, a0\n";
+    code << "    seqz a0, a0\n";
+    emitCseSave(id);
 }
 
-void CodeGenerator::visit(const IntLiteralNode &node)
+void CodeGenerator::visitIntLiteral(NodeId id)
 {
-    output << "    li a0, " << node.value << "\n";
+    code << "    li a0, " << ast->intValue(id) << "\n";
 }
 
-void CodeGenerator::visit(const StringLiteralNode &node)
+void CodeGenerator::visitStringLiteral(NodeId id)
 {
-    std::string label = getStringLabel(node.value);
-    output << "    la a0, " << label << "\n";
+    // Метки всех литералов созданы при сборе информации
+    code << "    la a0, " << resolved.stringLiterals.at(ast->stringValue(id)) << "\n";
 }
 
-void CodeGenerator::visit(const IdentifierNode &node)
+void CodeGenerator::visitIdentifier(NodeId id)
 {
-    int offset = getVariableOffset(node.name);
-    output << "    lw a0, -" << offset << "(sp)   # load " << node.name << "\n";
+    emitLoadVariable(ast->name(id));
 }
\ No newline at end of file
@@ -2,47 +2,183 @@
 #define CODEGEN_HPP
 
 #include "ast.hpp"
+#include "cfg.hpp"
+#include "costmodel.hpp"
+#include "gvn.hpp"
+#include "passes.hpp"
+#include "precompute.hpp"
 #include <unordered_map>
 #include <ostream>
+#include <sstream>
 #include <string>
+#include <vector>
+#include <cstdint>
 
 class CodeGenerator
 {
 private:
     std::ostream &output;
-    std::unordered_map<std::string, int> variables; // имя -> смещение от sp
-    int stackOffset;
+    // Переменные, строки, профиль и общие подвыражения, разрешенные до
+    // генерации кода; фрагмент программы берет их у основного генератора
+    const CodeGenerator &resolved;
+    const Ast *ast;
+    ControlFlowGraph cfg;
+    int currentBlock;
+    std::ostringstream code; // код текущего базового блока
+    std::vector<CodeSegment> segments; // участки code по операторам
+    NodeId currentStatement;           // оператор, код которого генерируется
+    std::unordered_map<std::string, int> variables; // имя -> смещение вниз от s0 (верх кадра)
+    std::unordered_map<std::string, VarType> variableTypes;
+    int stackOffset;  // размер кадра: слоты временных значений и переменные
+    int spillSlots;   // слотов для левых операндов: наибольшая глубина выражения
+    int spillDepth;   // занятых слотов в текущем выражении
     int labelCounter;
     int stringCounter;
     std::unordered_map<std::string, std::string> stringLiterals; // строка -> метка
+    bool usesRuntime; // есть print: нужна среда выполнения с буфером вывода
+
+    // Профилирование: счетчики на ветках IfNode и обратных дугах WhileNode
+    bool profileGenerate;
+    bool profileUse;
+    std::vector<uint32_t> profileCounts;                        // прочитанный профиль
+    std::unordered_map<NodeId, int> profileCounters;            // узел -> первый счетчик
+    int profileCounterCount;
+    double currentFreq; // ожидаемое число выполнений текущего кода (по профилю)
+    double loopTripEstimate; // число итераций цикла, когда профиля нет
+    int loopDepth;
+
+    CostModel *costModel; // оценка стоимости по операторам (если запрошена)
+    int threadCount;      // потоков для генерации операторов верхнего уровня
+
+    // Переменные, размещенные в регистрах s1-s11 на все время работы программы
+    struct VariableUse
+    {
+        double loads = 0;  // ожидаемое число чтений (с учетом вложенности циклов)
+        double stores = 0; // ожидаемое число записей
+        int references = 0; // обращений в тексте программы (для -Os)
+    };
+    std::vector<std::string> declaredVariables; // в порядке объявления
+    std::unordered_map<std::string, VariableUse> variableUses;
+    std::unordered_map<std::string, std::string> variableRegisters; // имя -> регистр
+
+    // Общие подвыражения: разметка ValueNumbering и регистры временных значений
+    ValueNumbering valueNumbering;
+    std::vector<std::string> cseRegisters; // временное значение -> регистр ("" - не хватило)
+    bool cseEnabled;                       // выполнен проход cse
+
+    // Проходы оптимизации и результаты анализов графа для них
+    PassManager passes;
+    std::vector<bool> reachableBlocks;
+    std::vector<int> blockPredecessors;
+
+    // Выполнение программы при компиляции (--precompute)
+    long precomputeSteps;          // бюджет шагов, 0 - не выполнять
+    bool precomputed;              // программа завершилась, код - только вывод
+    long precomputeStepsUsed;
+    std::string precomputedOutput;
+    std::string precomputeFailure; // почему генерируется обычный код
 
     void genDataSection();
     void genTextSection();
+    void startBlock(int id);
+    void endWithJump(int target);
+    void endWithBranch(int trueTarget, int falseTarget, double trueFreq, double falseFreq);
+    BasicBlock &finishBlock();
+    NodeId enterStatement(NodeId id);
+    void leaveStatement(NodeId outer);
+    void markSegment();
+    void appendCode(const std::string &text, const std::vector<CodeSegment> &parts);
+    void precompute();
+    void lowerProgram();
+    void lowerPrecomputed();
+    void lowerStatements();
+    void emitProgram();
+    void mergeChunk(CodeGenerator &chunk);
     std::string getNewLabel();
     std::string getStringLabel(const std::string &str);
     void allocateVariable(const std::string &name);
     int getVariableOffset(const std::string &name);
-    void collectInfo(const ProgramNode &program);
-    void collectInfoFromNode(const ASTNode &node);
+    int temporaryDepth(NodeId id) const;
+    VarType expressionType(NodeId id) const;
+    void collectInfo();
+    void collectInfoFromNode(NodeId id, double freq);
+    void registerPasses();
+    int promoteVariables();
+    void allocateStack();
+    int enableCse();
+    void assignCseRegisters();
+    const CseAction *findCse(NodeId id) const;
+    bool emitCseReuse(NodeId id);
+    void emitCseSave(NodeId id);
+    std::string frameSlot(int offset);
+    void emitLoadVariable(const std::string &name);
+    void emitStoreVariable(const std::string &name);
+    void emitCounterIncrement(int counter);
+    void emitProfileDump();
+    double getCount(NodeId id, int index) const;
+
+    // Генерация кода узла: выбор метода по виду узла
+    void visit(NodeId id);
+    void visitVarDecl(NodeId id);
+    void visitAssign(NodeId id);
+    void visitPrint(NodeId id);
+    void visitIf(NodeId id);
+    void visitWhile(NodeId id);
+    void visitBlock(NodeId id);
+    void visitBinaryOp(NodeId id);
+    void visitUnaryOp(NodeId id);
+    void visitIntLiteral(NodeId id);
+    void visitStringLiteral(NodeId id);
+    void visitIdentifier(NodeId id);
+
+    // Генератор фрагмента программы: свой граф, блок 0 которого продолжает
+    // открытый блок основного генератора
+    CodeGenerator(const CodeGenerator &parent, CostModel *chunkCostModel);
 
 public:
-    CodeGenerator(std::ostream &out) : output(out), stackOffset(0), labelCounter(0), stringCounter(0) {}
-
-    void generateCode(const ProgramNode &program);
-
-    // Visitor методы для каждого типа узла
-    void visit(const ProgramNode &node);
-    void visit(const VarDeclNode &node);
-    void visit(const AssignNode &node);
-    void visit(const PrintNode &node);
-    void visit(const IfNode &node);
-    void visit(const WhileNode &node);
-    void visit(const BlockNode &node);
-    void visit(const BinaryOpNode &node);
-    void visit(const UnaryOpNode &node);
-    void visit(const IntLiteralNode &node);
-    void visit(const StringLiteralNode &node);
-    void visit(const IdentifierNode &node);
+    CodeGenerator(std::ostream &out)
+        : output(out), resolved(*this), ast(nullptr), currentBlock(0), currentStatement(NO_NODE),
+          stackOffset(0), spillSlots(0), spillDepth(0), labelCounter(0), stringCounter(0),
+          usesRuntime(false), profileGenerate(false), profileUse(false), profileCounterCount(0),
+          currentFreq(1.0), loopTripEstimate(10.0), loopDepth(0), costModel(nullptr),
+          threadCount(1), cseEnabled(false), precomputeSteps(0), precomputed(false),
+          precomputeStepsUsed(0)
+    {
+        registerPasses();
+    }
+
+    // -fprofile-generate: вставить счетчики и сбросить их в stderr при выходе
+    void enableProfileGenerate() { profileGenerate = true; }
+    // -fprofile-use: загрузить профиль, записанный инструментированной программой
+    bool loadProfile(const std::string &path);
+    // --trip-count: число итераций цикла для статической оценки частот
+    void setLoopTripEstimate(double trips) { loopTripEstimate = trips; }
+    // --cost-report: заполнить модель стоимости по сгенерированному коду
+    void setCostModel(CostModel *model) { costModel = model; }
+    // --threads: операторы верхнего уровня генерируются параллельно (0 - по
+    // числу ядер), результат совпадает с последовательной генерацией побайтно
+    void setThreadCount(int threads) { threadCount = threads; }
+
+    // --precompute: выполнить программу при компиляции и, если она уложилась
+    // в бюджет шагов, сгенерировать только запись ее вывода
+    void enablePrecompute(long steps) { precomputeSteps = steps; }
+
+    // -O0, -O1, -O2, -Os: набор проходов оптимизации (по умолчанию -O2)
+    bool setOptimizationLevel(const std::string &level) { return passes.setLevel(level); }
+    // --passes: свой список проходов вместо набора уровня -O
+    bool setPasses(const std::string &list, std::string &error)
+    {
+        return passes.setPipeline(list, error);
+    }
+
+    // Какие переменные получили регистры и сколько обращений к памяти сэкономлено
+    void printPromotionReport(std::ostream &out) const;
+    // Результат выполнения при компиляции или причина отказа от него
+    void printPrecomputeReport(std::ostream &out) const;
+    // Время и число изменений каждого прохода, вычисления анализов
+    void printPassReport(std::ostream &out) const { passes.writeReport(out); }
+
+    void generateCode(const Ast &tree);
 };
 
 #endif // CODEGEN_HPP
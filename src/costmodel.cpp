@@ -0,0 +1,338 @@
+#include "costmodel.hpp"
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <map>
+#include <sstream>
+
+// Такты на инструкцию в модели конвейера
+static const double ALU_CYCLES = 1;
+static const double LOAD_CYCLES = 2;
+static const double STORE_CYCLES = 1;
+static const double MUL_CYCLES = 3;
+static const double DIV_CYCLES = 34;
+static const double TAKEN_BRANCH_CYCLES = 3;
+static const double ECALL_CYCLES = 100;
+
+// Средняя стоимость подпрограмм среды выполнения (без учета сброса буфера)
+static double runtimeCallCycles(const std::string &target)
+{
+    if (target == "__rt_print_int")
+    {
+        return 80; // несколько цифр: mulhu, запись и копирование байтов
+    }
+    if (target == "__rt_print_str")
+    {
+        return 40;
+    }
+    if (target == "__rt_flush")
+    {
+        return ECALL_CYCLES + 10;
+    }
+    return 0;
+}
+
+static std::string statementKind(const Ast &ast, NodeId statement)
+{
+    if (statement == NO_NODE)
+    {
+        return "program";
+    }
+    switch (ast.kind(statement))
+    {
+    case NodeKind::VAR_DECL:
+        return "declaration";
+    case NodeKind::ASSIGN:
+        return "assignment";
+    case NodeKind::PRINT:
+        return "print";
+    case NodeKind::IF:
+        return "if";
+    case NodeKind::WHILE:
+        return "while";
+    default:
+        return "statement";
+    }
+}
+
+CostModel::StatementCost &CostModel::costOf(NodeId statement)
+{
+    auto it = index.find(statement);
+    if (it != index.end())
+    {
+        return statements[it->second];
+    }
+    StatementCost cost;
+    cost.statement = statement;
+    cost.executions = 1;
+    index[statement] = statements.size();
+    statements.push_back(cost);
+    return statements.back();
+}
+
+void CostModel::addStatement(NodeId statement, int loopDepth, double executions)
+{
+    StatementCost &cost = costOf(statement);
+    cost.loopDepth = loopDepth;
+    cost.executions = executions;
+}
+
+void CostModel::appendStatements(const CostModel &chunk)
+{
+    for (const auto &cost : chunk.statements)
+    {
+        addStatement(cost.statement, cost.loopDepth, cost.executions);
+    }
+}
+
+// Сколько машинных инструкций дает псевдоинструкция: la и call - пара
+// auipc с addi или jalr, li с константой вне 12 бит - lui и addi
+static int expandedLength(const std::string &mnemonic, const std::string &lastOperand)
+{
+    if (mnemonic == "la" || mnemonic == "call")
+    {
+        return 2;
+    }
+    if (mnemonic == "li")
+    {
+        long value = strtol(lastOperand.c_str(), nullptr, 0);
+        bool fitsAddi = value >= -2048 && value < 2048;
+        bool fitsLui = (value & 0xfff) == 0;
+        return fitsAddi || fitsLui ? 1 : 2;
+    }
+    return 1;
+}
+
+void CostModel::addInstruction(StatementCost &cost, const std::string &line, double freq)
+{
+    // Метки, директивы и комментарии инструкциями не считаем
+    std::istringstream in(line.substr(0, line.find('#')));
+    std::string mnemonic;
+    if (!(in >> mnemonic) || mnemonic[0] == '.' || mnemonic.back() == ':')
+    {
+        return;
+    }
+    std::string operand;
+    std::string lastOperand;
+    while (in >> operand)
+    {
+        lastOperand = operand;
+    }
+
+    // Каждая инструкция пары (auipc или lui и вторая) - такт
+    int length = expandedLength(mnemonic, lastOperand);
+    double cycles = ALU_CYCLES * length;
+    if (mnemonic == "lw" || mnemonic == "lh" || mnemonic == "lhu" || mnemonic == "lb" ||
+        mnemonic == "lbu")
+    {
+        cycles = LOAD_CYCLES;
+        cost.memoryOps++;
+    }
+    else if (mnemonic == "sw" || mnemonic == "sh" || mnemonic == "sb")
+    {
+        cycles = STORE_CYCLES;
+        cost.memoryOps++;
+    }
+    else if (mnemonic == "mul" || mnemonic == "mulh" || mnemonic == "mulhu" || mnemonic == "mulhsu")
+    {
+        cycles = MUL_CYCLES;
+    }
+    else if (mnemonic == "div" || mnemonic == "divu" || mnemonic == "rem" || mnemonic == "remu")
+    {
+        cycles = DIV_CYCLES;
+    }
+    else if (mnemonic == "call" || mnemonic == "jal" || mnemonic == "j" || mnemonic == "jr" ||
+             mnemonic == "jalr" || mnemonic == "ret")
+    {
+        // Переход выполняется всегда; вызов - вместе с подпрограммой
+        cycles = ALU_CYCLES * (length - 1) + TAKEN_BRANCH_CYCLES + runtimeCallCycles(lastOperand);
+        cost.branches++;
+    }
+    else if (mnemonic == "ecall")
+    {
+        cycles = ECALL_CYCLES;
+    }
+
+    cost.instructions += length;
+    cost.executedInstructions += length * freq;
+    cost.cycles += cycles * freq;
+}
+
+void CostModel::addExit(StatementCost &cost, const ExitInstruction &exit)
+{
+    // Невыполненный условный переход стоит такт, выполненный - три
+    cost.instructions++;
+    cost.branches++;
+    cost.executedInstructions += exit.executions;
+    cost.cycles += (exit.executions - exit.taken) * ALU_CYCLES + exit.taken * TAKEN_BRANCH_CYCLES;
+}
+
+void CostModel::analyze(const ControlFlowGraph &cfg, const Ast &ast, double tripCount, bool profile)
+{
+    loopTripCount = tripCount;
+    fromProfile = profile;
+
+    const auto &placement = cfg.placement();
+    for (size_t pos = 0; pos < placement.size(); ++pos)
+    {
+        const BasicBlock &b = cfg.block(placement[pos]);
+        for (size_t i = 0; i < b.segments.size(); ++i)
+        {
+            size_t begin = b.segments[i].offset;
+            size_t end = i + 1 < b.segments.size() ? b.segments[i + 1].offset : b.code.size();
+            StatementCost &cost = costOf(b.segments[i].owner);
+
+            std::istringstream lines(b.code.substr(begin, end - begin));
+            std::string line;
+            while (std::getline(lines, line))
+            {
+                addInstruction(cost, line, b.freq);
+            }
+        }
+        for (const auto &exit : cfg.exitInstructions(pos))
+        {
+            addExit(costOf(b.exitOwner), exit);
+        }
+    }
+
+    for (auto &cost : statements)
+    {
+        cost.line = cost.statement != NO_NODE ? ast.line(cost.statement) : 0;
+        cost.kind = statementKind(ast, cost.statement);
+    }
+}
+
+// Число без лишних нулей: 12, 0.5, 1.25
+static std::string formatNumber(double value)
+{
+    char buffer[64];
+    snprintf(buffer, sizeof(buffer), "%.2f", value);
+    std::string text = buffer;
+    text.erase(text.find_last_not_of('0') + 1);
+    if (text.back() == '.')
+    {
+        text.pop_back();
+    }
+    return text;
+}
+
+void CostModel::writeAnnotatedSource(std::ostream &out,
+                                     const std::vector<std::string> &sourceLines) const
+{
+    // Операторы одной строки складываем
+    std::map<int, StatementCost> byLine;
+    const StatementCost *program = nullptr;
+    double totalCycles = 0;
+    int totalInstructions = 0;
+    for (const auto &cost : statements)
+    {
+        totalCycles += cost.cycles;
+        totalInstructions += cost.instructions;
+        if (cost.statement == NO_NODE)
+        {
+            program = &cost;
+            continue;
+        }
+        auto it = byLine.find(cost.line);
+        if (it == byLine.end())
+        {
+            byLine[cost.line] = cost;
+            continue;
+        }
+        StatementCost &sum = it->second;
+        sum.kind += ", " + cost.kind;
+        sum.executions = std::max(sum.executions, cost.executions);
+        sum.loopDepth = std::max(sum.loopDepth, cost.loopDepth);
+        sum.instructions += cost.instructions;
+        sum.memoryOps += cost.memoryOps;
+        sum.branches += cost.branches;
+        sum.executedInstructions += cost.executedInstructions;
+        sum.cycles += cost.cycles;
+    }
+
+    char row[256];
+    out << "# Static cost estimate: in-order RV32IM, "
+        << (fromProfile ? "profile counts" : "loop trip count " + formatNumber(loopTripCount))
+        << "\n";
+    out << "# instrs/mem/br: static counts, la/call/li expanded to machine instructions; "
+           "execs and cycles: expected over the whole run\n";
+    snprintf(row, sizeof(row), "%5s %6s %4s %3s %5s %10s %11s %12s | %s\n", "line", "instrs",
+             "mem", "br", "depth", "execs", "cycles/exec", "cycles", "source");
+    out << row;
+
+    auto printCost = [&](const std::string &label, const StatementCost &cost, const std::string &text)
+    {
+        double perExecution = cost.executions > 0 ? cost.cycles / cost.executions : 0;
+        snprintf(row, sizeof(row), "%5s %6d %4d %3d %5d %10s %11s %12s | ", label.c_str(),
+                 cost.instructions, cost.memoryOps, cost.branches, cost.loopDepth,
+                 formatNumber(cost.executions).c_str(), formatNumber(perExecution).c_str(),
+                 formatNumber(cost.cycles).c_str());
+        out << row << text << "\n";
+    };
+
+    if (sourceLines.empty())
+    {
+        for (const auto &entry : byLine)
+        {
+            printCost(std::to_string(entry.first), entry.second, entry.second.kind);
+        }
+    }
+    else
+    {
+        for (size_t i = 0; i < sourceLines.size(); ++i)
+        {
+            int line = static_cast<int>(i) + 1;
+            auto it = byLine.find(line);
+            if (it != byLine.end())
+            {
+                printCost(std::to_string(line), it->second, sourceLines[i]);
+            }
+            else
+            {
+                snprintf(row, sizeof(row), "%5d %6s %4s %3s %5s %10s %11s %12s | ", line, "", "",
+                         "", "", "", "", "");
+                out << row << sourceLines[i] << "\n";
+            }
+        }
+    }
+    if (program)
+    {
+        printCost("-", *program, "(program entry and exit)");
+    }
+    out << "# total: " << totalInstructions << " instructions, "
+        << formatNumber(totalCycles) << " estimated cycles (runtime calls at average cost)\n";
+}
+
+void CostModel::writeJson(std::ostream &out) const
+{
+    double totalCycles = 0;
+    int totalInstructions = 0;
+    for (const auto &cost : statements)
+    {
+        totalCycles += cost.cycles;
+        totalInstructions += cost.instructions;
+    }
+
+    out << "{\n";
+    out << "  \"model\": \"in-order RV32IM\",\n";
+    out << "  \"frequencies\": \"" << (fromProfile ? "profile" : "static") << "\",\n";
+    out << "  \"loop_trip_count\": " << formatNumber(loopTripCount) << ",\n";
+    out << "  \"total_instructions\": " << totalInstructions << ",\n";
+    out << "  \"total_cycles\": " << formatNumber(totalCycles) << ",\n";
+    out << "  \"statements\": [";
+    bool first = true;
+    for (const auto &cost : statements)
+    {
+        out << (first ? "\n" : ",\n");
+        first = false;
+        out << "    {\"line\": " << cost.line << ", \"kind\": \"" << cost.kind
+            << "\", \"loop_depth\": " << cost.loopDepth
+            << ", \"executions\": " << formatNumber(cost.executions)
+            << ", \"instructions\": " << cost.instructions
+            << ", \"memory_ops\": " << cost.memoryOps << ", \"branches\": " << cost.branches
+            << ", \"executed_instructions\": " << formatNumber(cost.executedInstructions)
+            << ", \"cycles\": " << formatNumber(cost.cycles) << "}";
+    }
+    out << "\n  ]\n";
+    out << "}\n";
+}
@@ -0,0 +1,63 @@
+#ifndef COSTMODEL_HPP
+#define COSTMODEL_HPP
+
+#include "ast.hpp"
+#include "cfg.hpp"
+#include <ostream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Статическая оценка стоимости сгенерированного кода по операторам программы.
+// Модель - простой конвейер RV32IM с выполнением по порядку: инструкция
+// занимает такт, загрузка - два (зависимая инструкция ждет результат),
+// mul - 3, div - 34, выполненный переход - 3 (сброс выборки).
+// Псевдоинструкции считаются по длине после ассемблера: la и call - две
+// инструкции, li - одна или две в зависимости от константы.
+// Частоты блоков те же, что использует генератор: профиль или оценка
+// с заданным числом итераций циклов.
+class CostModel
+{
+public:
+    struct StatementCost
+    {
+        NodeId statement = NO_NODE; // NO_NODE - пролог и завершение программы
+        int line = 0;
+        std::string kind;
+        int loopDepth = 0;
+        double executions = 0;         // сколько раз выполняется оператор
+        int instructions = 0;          // инструкций в коде оператора
+        int memoryOps = 0;             // из них загрузок и сохранений
+        int branches = 0;              // из них переходов и вызовов
+        double executedInstructions = 0;
+        double cycles = 0;             // оценка тактов за все выполнения
+    };
+
+private:
+    std::vector<StatementCost> statements; // в порядке генерации
+    std::unordered_map<NodeId, size_t> index;
+    double loopTripCount;
+    bool fromProfile;
+
+    StatementCost &costOf(NodeId statement);
+    void addInstruction(StatementCost &cost, const std::string &line, double freq);
+    void addExit(StatementCost &cost, const ExitInstruction &exit);
+
+public:
+    CostModel() : loopTripCount(0), fromProfile(false) {}
+
+    // Генератор сообщает об операторе, когда начинает его код
+    void addStatement(NodeId statement, int loopDepth, double executions);
+    // Операторы фрагмента, сгенерированного отдельно, - в конец списка
+    void appendStatements(const CostModel &chunk);
+    // Разбор размещенного графа: код каждого участка относится к его оператору
+    void analyze(const ControlFlowGraph &cfg, const Ast &ast, double tripCount, bool profile);
+
+    const std::vector<StatementCost> &costs() const { return statements; }
+
+    // Исходный текст с оценкой у каждой строки (без текста - только операторы)
+    void writeAnnotatedSource(std::ostream &out, const std::vector<std::string> &sourceLines) const;
+    void writeJson(std::ostream &out) const;
+};
+
+#endif // COSTMODEL_HPP
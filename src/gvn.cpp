@@ -0,0 +1,359 @@
+#include "gvn.hpp"
+#include <algorithm>
+
+// Код операции NOT в ключе выражения (после всех BinOpType)
+static const int UNARY_NOT_OP = 100;
+
+int ValueNumbering::variableNumber(const std::string &name)
+{
+    // Начальное значение переменной неизвестно, но одинаково на всех путях
+    auto it = varNumbers.find(name);
+    if (it != varNumbers.end())
+    {
+        return it->second;
+    }
+    int number = newNumber();
+    varNumbers[name] = number;
+    holders[number].push_back(name);
+    return number;
+}
+
+void ValueNumbering::setVariable(const std::string &name, int number)
+{
+    auto it = varNumbers.find(name);
+    varLog.push_back({name, it != varNumbers.end() ? it->second : -1});
+    varNumbers[name] = number;
+    holders[number].push_back(name);
+}
+
+void ValueNumbering::rollbackVariables(size_t mark, std::unordered_map<std::string, int> &changes)
+{
+    // Запоминаем итоговые номера измененных переменных и возвращаем прежние
+    for (size_t i = mark; i < varLog.size(); ++i)
+    {
+        changes[varLog[i].first] = varNumbers[varLog[i].first];
+    }
+    while (varLog.size() > mark)
+    {
+        const auto &entry = varLog.back();
+        if (entry.second < 0)
+        {
+            varNumbers.erase(entry.first);
+        }
+        else
+        {
+            varNumbers[entry.first] = entry.second;
+        }
+        varLog.pop_back();
+    }
+}
+
+void ValueNumbering::popAvailable(size_t mark)
+{
+    while (availableLog.size() > mark)
+    {
+        available.erase(availableLog.back());
+        availableLog.pop_back();
+    }
+}
+
+std::string ValueNumbering::findHolder(int number)
+{
+    auto it = holders.find(number);
+    if (it == holders.end())
+    {
+        return "";
+    }
+    // Список может содержать переменные, которым с тех пор присвоено другое значение
+    auto &names = it->second;
+    names.erase(std::remove_if(names.begin(), names.end(),
+                               [this, number](const std::string &name)
+                               {
+                                   auto var = varNumbers.find(name);
+                                   return var == varNumbers.end() || var->second != number;
+                               }),
+                names.end());
+    return names.empty() ? "" : names.front();
+}
+
+int ValueNumbering::numberOf(NodeId id)
+{
+    auto cached = memo.find(id);
+    if (cached != memo.end())
+    {
+        return cached->second;
+    }
+
+    int number;
+    switch (ast->kind(id))
+    {
+    case NodeKind::INT_LITERAL:
+    {
+        int value = ast->intValue(id);
+        auto it = constNumbers.find(value);
+        number = it != constNumbers.end() ? it->second : (constNumbers[value] = newNumber());
+        break;
+    }
+    case NodeKind::STRING_LITERAL:
+    {
+        const std::string &value = ast->stringValue(id);
+        auto it = stringNumbers.find(value);
+        number = it != stringNumbers.end() ? it->second : (stringNumbers[value] = newNumber());
+        break;
+    }
+    case NodeKind::IDENTIFIER:
+        number = variableNumber(ast->name(id));
+        break;
+    case NodeKind::UNARY_OP:
+    {
+        ExprKey key = {UNARY_NOT_OP, numberOf(ast->operand(id)), -1};
+        auto it = exprNumbers.find(key);
+        number = it != exprNumbers.end() ? it->second : (exprNumbers[key] = newNumber());
+        break;
+    }
+    default:
+    {
+        int left = numberOf(ast->left(id));
+        int right = numberOf(ast->right(id));
+        BinOpType op = ast->binOp(id);
+
+        // a > b и b < a - одно значение
+        if (op == BinOpType::GT || op == BinOpType::GE)
+        {
+            op = op == BinOpType::GT ? BinOpType::LT : BinOpType::LE;
+            std::swap(left, right);
+        }
+        // Коммутативные операции: порядок операндов не важен
+        if ((op == BinOpType::PLUS || op == BinOpType::MUL || op == BinOpType::EQ ||
+             op == BinOpType::NEQ || op == BinOpType::AND || op == BinOpType::OR) &&
+            left > right)
+        {
+            std::swap(left, right);
+        }
+
+        ExprKey key = {static_cast<int>(op), left, right};
+        auto it = exprNumbers.find(key);
+        number = it != exprNumbers.end() ? it->second : (exprNumbers[key] = newNumber());
+        break;
+    }
+    }
+
+    memo[id] = number;
+    return number;
+}
+
+int ValueNumbering::tempFor(const Available &source)
+{
+    auto it = sourceTemps.find(source.node);
+    if (it != sourceTemps.end())
+    {
+        return it->second;
+    }
+    int temp = static_cast<int>(cseTemps.size());
+    cseTemps.push_back({source.step, source.step});
+    sourceTemps[source.node] = temp;
+
+    CseAction save;
+    save.kind = CseAction::Kind::SAVE;
+    save.temp = temp;
+    cseActions[source.node] = save;
+    return temp;
+}
+
+void ValueNumbering::visitExpression(NodeId id)
+{
+    // Переменные и литералы загружаются одной инструкцией - их не переиспользуем
+    NodeKind kind = ast->kind(id);
+    if (kind != NodeKind::BINARY_OP && kind != NodeKind::UNARY_OP)
+    {
+        return;
+    }
+
+    int number = numberOf(id);
+    ++step;
+
+    auto it = available.find(number);
+    std::string holder = findHolder(number);
+    if (it != available.end() && (holder.empty() || sourceTemps.count(it->second.node)))
+    {
+        int temp = tempFor(it->second);
+        cseTemps[temp].end = step;
+
+        // Значение из-за цикла используется на каждой итерации
+        for (auto &loop : loops)
+        {
+            if (loop.start > cseTemps[temp].start)
+            {
+                loop.extend.push_back(temp);
+                break;
+            }
+        }
+
+        CseAction reuse;
+        reuse.kind = CseAction::Kind::REUSE_TEMP;
+        reuse.temp = temp;
+        cseActions[id] = reuse;
+        return;
+    }
+    if (!holder.empty())
+    {
+        CseAction reuse;
+        reuse.kind = CseAction::Kind::REUSE_VARIABLE;
+        reuse.variable = holder;
+        cseActions[id] = reuse;
+        return;
+    }
+
+    if (kind == NodeKind::BINARY_OP)
+    {
+        visitExpression(ast->left(id));
+        visitExpression(ast->right(id));
+    }
+    else
+    {
+        visitExpression(ast->operand(id));
+    }
+
+    available[number] = {id, step};
+    availableLog.push_back(number);
+}
+
+void ValueNumbering::collectAssigned(NodeId id, std::unordered_set<std::string> &names) const
+{
+    switch (ast->kind(id))
+    {
+    case NodeKind::ASSIGN:
+        names.insert(ast->name(id));
+        break;
+    case NodeKind::BLOCK:
+        for (NodeId stmt : ast->statements(id))
+        {
+            collectAssigned(stmt, names);
+        }
+        break;
+    case NodeKind::IF:
+        collectAssigned(ast->thenStmt(id), names);
+        if (ast->elseStmt(id) != NO_NODE)
+        {
+            collectAssigned(ast->elseStmt(id), names);
+        }
+        break;
+    case NodeKind::WHILE:
+        collectAssigned(ast->body(id), names);
+        break;
+    default:
+        break;
+    }
+}
+
+void ValueNumbering::visitStatement(NodeId id)
+{
+    switch (ast->kind(id))
+    {
+    case NodeKind::ASSIGN:
+        memo.clear();
+        visitExpression(ast->expression(id));
+        // Присваивание меняет номер переменной: старые выражения с ней
+        // больше не совпадут по ключу
+        setVariable(ast->name(id), numberOf(ast->expression(id)));
+        break;
+    case NodeKind::PRINT:
+        memo.clear();
+        visitExpression(ast->expression(id));
+        break;
+    case NodeKind::BLOCK:
+        for (NodeId stmt : ast->statements(id))
+        {
+            visitStatement(stmt);
+        }
+        break;
+    case NodeKind::IF:
+    {
+        memo.clear();
+        visitExpression(ast->condition(id));
+
+        size_t varMark = varLog.size();
+        size_t availMark = availableLog.size();
+        std::unordered_map<std::string, int> thenChanges;
+        std::unordered_map<std::string, int> elseChanges;
+
+        visitStatement(ast->thenStmt(id));
+        popAvailable(availMark);
+        rollbackVariables(varMark, thenChanges);
+
+        if (ast->elseStmt(id) != NO_NODE)
+        {
+            visitStatement(ast->elseStmt(id));
+            popAvailable(availMark);
+            rollbackVariables(varMark, elseChanges);
+        }
+
+        // Слияние: если ветки оставили разные значения, значение новое
+        std::vector<std::string> changed;
+        for (const auto &pair : thenChanges)
+        {
+            changed.push_back(pair.first);
+        }
+        for (const auto &pair : elseChanges)
+        {
+            if (!thenChanges.count(pair.first))
+            {
+                changed.push_back(pair.first);
+            }
+        }
+        std::sort(changed.begin(), changed.end());
+        for (const auto &name : changed)
+        {
+            auto thenIt = thenChanges.find(name);
+            auto elseIt = elseChanges.find(name);
+            int thenNumber = thenIt != thenChanges.end() ? thenIt->second : variableNumber(name);
+            int elseNumber = elseIt != elseChanges.end() ? elseIt->second : variableNumber(name);
+            setVariable(name, thenNumber == elseNumber ? thenNumber : newNumber());
+        }
+        break;
+    }
+    case NodeKind::WHILE:
+    {
+        // В заголовке цикла сходятся вход и обратная дуга: все переменные,
+        // которые меняет тело, получают новые номера
+        std::unordered_set<std::string> assigned;
+        collectAssigned(ast->body(id), assigned);
+        std::vector<std::string> names(assigned.begin(), assigned.end());
+        std::sort(names.begin(), names.end());
+        for (const auto &name : names)
+        {
+            setVariable(name, newNumber());
+        }
+
+        loops.push_back({++step, {}});
+        memo.clear();
+        visitExpression(ast->condition(id));
+
+        size_t varMark = varLog.size();
+        size_t availMark = availableLog.size();
+        std::unordered_map<std::string, int> bodyChanges;
+        visitStatement(ast->body(id));
+        popAvailable(availMark);
+        rollbackVariables(varMark, bodyChanges);
+
+        ++step;
+        for (int temp : loops.back().extend)
+        {
+            cseTemps[temp].end = std::max(cseTemps[temp].end, step);
+        }
+        loops.pop_back();
+        break;
+    }
+    default:
+        break;
+    }
+}
+
+void ValueNumbering::run(const Ast &tree)
+{
+    ast = &tree;
+    for (NodeId stmt : ast->statements(ast->root()))
+    {
+        visitStatement(stmt);
+    }
+}
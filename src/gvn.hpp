@@ -0,0 +1,112 @@
+#ifndef GVN_HPP
+#define GVN_HPP
+
+#include "ast.hpp"
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+// Что генератор делает с выражением, значение которого уже вычислялось
+struct CseAction
+{
+    enum class Kind
+    {
+        SAVE,          // вычислить и сохранить во временное значение temp
+        REUSE_TEMP,    // взять из временного значения temp
+        REUSE_VARIABLE // взять из переменной, которой присвоено то же значение
+    };
+
+    Kind kind;
+    int temp = -1;
+    std::string variable;
+};
+
+// Временное значение: живет от вычисления до последнего использования
+// (шаги обхода программы в порядке исполнения кода)
+struct CseTemp
+{
+    int start;
+    int end;
+};
+
+// Нумерация значений по дереву доминаторов. Для структурной программы
+// дерево доминаторов повторяет вложенность AST: условие if доминирует
+// обе ветки, условие while - тело и выход, ветки не доминируют код после if.
+class ValueNumbering
+{
+private:
+    struct ExprKey
+    {
+        int op;
+        int left;
+        int right;
+        bool operator==(const ExprKey &other) const
+        {
+            return op == other.op && left == other.left && right == other.right;
+        }
+    };
+    struct ExprKeyHash
+    {
+        size_t operator()(const ExprKey &key) const
+        {
+            return (static_cast<size_t>(key.op) * 1000003u) ^
+                   (static_cast<size_t>(key.left) * 10007u) ^ static_cast<size_t>(key.right);
+        }
+    };
+    struct Available
+    {
+        NodeId node;
+        int step;
+    };
+    struct Loop
+    {
+        int start;
+        std::vector<int> extend; // временные значения, живые до конца цикла
+    };
+
+    const Ast *ast;
+    int nextNumber;
+    int step;
+    std::unordered_map<ExprKey, int, ExprKeyHash> exprNumbers;
+    std::unordered_map<int, int> constNumbers;
+    std::unordered_map<std::string, int> stringNumbers;
+
+    // Текущие номера переменных и журнал для отката при выходе из ветки
+    std::unordered_map<std::string, int> varNumbers;
+    std::vector<std::pair<std::string, int>> varLog; // (имя, прежний номер или -1)
+    std::unordered_map<int, std::vector<std::string>> holders;
+
+    // Доступные значения; откатываются при выходе из области доминирования
+    std::unordered_map<int, Available> available;
+    std::vector<int> availableLog;
+
+    std::unordered_map<NodeId, int> memo; // номера узлов текущего выражения
+    std::unordered_map<NodeId, int> sourceTemps;
+    std::vector<Loop> loops;
+
+    std::unordered_map<NodeId, CseAction> cseActions;
+    std::vector<CseTemp> cseTemps;
+
+    int newNumber() { return nextNumber++; }
+    int variableNumber(const std::string &name);
+    void setVariable(const std::string &name, int number);
+    void rollbackVariables(size_t mark, std::unordered_map<std::string, int> &changes);
+    void popAvailable(size_t mark);
+    std::string findHolder(int number);
+    int numberOf(NodeId id);
+    int tempFor(const Available &source);
+    void visitStatement(NodeId id);
+    void visitExpression(NodeId id);
+    void collectAssigned(NodeId id, std::unordered_set<std::string> &names) const;
+
+public:
+    ValueNumbering() : ast(nullptr), nextNumber(0), step(0) {}
+
+    void run(const Ast &tree);
+
+    const std::unordered_map<NodeId, CseAction> &actions() const { return cseActions; }
+    const std::vector<CseTemp> &temps() const { return cseTemps; }
+};
+
+#endif // GVN_HPP
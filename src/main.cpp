@@ -1,82 +1,397 @@
 #include "ast.hpp"
 #include "codegen.hpp"
+#include "pratt.hpp"
+#include <chrono>
 #include <cstdio>
+#include <cstdlib>
 #include <iostream>
 #include <fstream>
+#include <string>
+#include <vector>
 
 extern int yyparse();
 extern FILE *yyin;
 extern int yydebug;
+extern size_t parse_token_count;
+
+// Параметры командной строки
+struct Options
+{
+    const char *inputFile = nullptr;
+    const char *outputFile = nullptr;
+    bool profileGenerate = false;
+    std::string profileUse;
+    std::string costReport;        // файл отчета о стоимости ("" - не нужен)
+    bool costJson = false;         // --cost-format=json
+    double tripCount = 10.0;       // --trip-count: итераций цикла без профиля (и для кода)
+    int threads = 1;               // --threads: 1 - без потоков, 0 - по числу ядер
+    bool handParser = false;       // --parser=hand: рекурсивный спуск вместо Bison
+    bool parseStats = false;       // --parse-stats: только разбор, его скорость и память AST
+    std::string optLevel = "-O2";  // -O0, -O1, -O2, -Os
+    std::string passes;            // --passes: свой список проходов
+    bool customPasses = false;
+    bool passStats = false;        // --pass-stats: время и изменения проходов
+    long precomputeSteps = 0;      // --precompute[=шаги]: выполнить при компиляции
+    bool help = false;             // -h, --help
+};
+
+static void printUsage(const char *program)
+{
+    printf("Usage: %s [options] [input.prog] [output.s]\n", program);
+    printf("\n"
+           "Optimization:\n"
+           "  -O0, -O1, -O2, -Os      optimization level (default -O2)\n"
+           "  --passes=a,b,...        explicit pass list, AST passes first\n"
+           "  --pass-stats            print time and changes per pass\n"
+           "  --threads=N             lower top-level statements in N threads\n"
+           "                          (default 1; 0: one per core)\n"
+           "  --precompute[=STEPS]    run the program at compile time (default 10M steps)\n"
+           "  --trip-count=N          iterations assumed per loop without a profile (default 10).\n"
+           "                          This is a code generation option: it sets the block\n"
+           "                          frequencies used by layout and the weights used to pick\n"
+           "                          variables for registers, as well as the cost report\n"
+           "\n"
+           "Profile:\n"
+           "  -fprofile-generate      count if arms and loop back edges; counters go to stderr\n"
+           "  -fprofile-use=FILE      use counters from FILE instead of --trip-count\n"
+           "\n"
+           "Cost report:\n"
+           "  --cost-report=FILE      write a cost estimate per source statement\n"
+           "  --cost-format=text|json report format (default text)\n"
+           "\n"
+           "Parser:\n"
+           "  --parser=bison|hand     parser to use (default bison)\n"
+           "  --parse-stats           parse only; print parsing speed, AST size and teardown time\n"
+           "  -h, --help              print this help\n");
+}
+
+static bool parseOptions(int argc, char *argv[], Options &options)
+{
+    std::vector<const char *> positional;
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string arg = argv[i];
+        if (arg == "-h" || arg == "--help")
+        {
+            options.help = true;
+        }
+        else if (arg == "-fprofile-generate")
+        {
+            options.profileGenerate = true;
+        }
+        else if (arg.rfind("-fprofile-use=", 0) == 0)
+        {
+            options.profileUse = arg.substr(14);
+        }
+        else if (arg.rfind("--cost-report=", 0) == 0)
+        {
+            options.costReport = arg.substr(14);
+        }
+        else if (arg == "--cost-format=json" || arg == "--cost-format=text")
+        {
+            options.costJson = arg == "--cost-format=json";
+        }
+        else if (arg == "--parser=hand" || arg == "--parser=bison")
+        {
+            options.handParser = arg == "--parser=hand";
+        }
+        else if (arg == "--parse-stats")
+        {
+            options.parseStats = true;
+        }
+        else if (arg == "-O0" || arg == "-O1" || arg == "-O2" || arg == "-Os")
+        {
+            options.optLevel = arg;
+        }
+        else if (arg.rfind("--passes=", 0) == 0)
+        {
+            options.passes = arg.substr(9);
+            options.customPasses = true;
+        }
+        else if (arg == "--pass-stats")
+        {
+            options.passStats = true;
+        }
+        else if (arg == "--precompute")
+        {
+            options.precomputeSteps = PRECOMPUTE_DEFAULT_STEPS;
+        }
+        else if (arg.rfind("--precompute=", 0) == 0)
+        {
+            char *end = nullptr;
+            options.precomputeSteps = strtol(arg.c_str() + 13, &end, 10);
+            if (*end != '\0' || end == arg.c_str() + 13 || options.precomputeSteps <= 0)
+            {
+                printf("Error: Invalid step budget %s\n", arg.c_str() + 13);
+                return false;
+            }
+        }
+        else if (arg.rfind("--threads=", 0) == 0)
+        {
+            char *end = nullptr;
+            long threads = strtol(arg.c_str() + 10, &end, 10);
+            if (*end != '\0' || end == arg.c_str() + 10 || threads < 0 || threads > 1024)
+            {
+                printf("Error: Invalid thread count %s\n", arg.c_str() + 10);
+                return false;
+            }
+            options.threads = static_cast<int>(threads);
+        }
+        else if (arg.rfind("--trip-count=", 0) == 0)
+        {
+            char *end = nullptr;
+            options.tripCount = strtod(arg.c_str() + 13, &end);
+            if (*end != '\0' || !(options.tripCount >= 0))
+            {
+                printf("Error: Invalid trip count %s\n", arg.c_str() + 13);
+                return false;
+            }
+        }
+        else if (arg.size() > 1 && arg[0] == '-')
+        {
+            printf("Error: Unknown option %s\n", argv[i]);
+            return false;
+        }
+        else
+        {
+            positional.push_back(argv[i]);
+        }
+    }
+
+    if (positional.size() > 2)
+    {
+        printUsage(argv[0]);
+        return false;
+    }
+    if (options.profileGenerate && !options.profileUse.empty())
+    {
+        printf("Error: -fprofile-generate and -fprofile-use are mutually exclusive\n");
+        return false;
+    }
+    if (positional.size() > 0)
+    {
+        options.inputFile = positional[0];
+    }
+    if (positional.size() > 1)
+    {
+        options.outputFile = positional[1];
+    }
+    return true;
+}
+
+// Весь входной файл для анализатора, написанного вручную
+static std::string readInput(FILE *in)
+{
+    std::string text;
+    char buffer[65536];
+    size_t count;
+    while ((count = fread(buffer, 1, sizeof(buffer), in)) > 0)
+    {
+        text.append(buffer, count);
+    }
+    return text;
+}
+
+// Настройка генератора по параметрам командной строки
+static bool configureGenerator(CodeGenerator &generator, const Options &options)
+{
+    if (options.profileGenerate)
+    {
+        generator.enableProfileGenerate();
+    }
+    if (!options.profileUse.empty() && !generator.loadProfile(options.profileUse))
+    {
+        printf("Error: Could not read profile %s\n", options.profileUse.c_str());
+        return false;
+    }
+    generator.setLoopTripEstimate(options.tripCount);
+    generator.setThreadCount(options.threads);
+    generator.enablePrecompute(options.precomputeSteps);
+
+    // Список --passes заменяет набор уровня; -Os при этом остается в силе
+    generator.setOptimizationLevel(options.optLevel);
+    std::string error;
+    if (options.customPasses && !generator.setPasses(options.passes, error))
+    {
+        printf("Error: Invalid --passes: %s\n", error.c_str());
+        return false;
+    }
+    return true;
+}
+
+// Отчет о стоимости: исходный текст с оценкой по строкам или JSON
+static bool writeCostReport(const CostModel &model, const Options &options)
+{
+    std::ofstream out(options.costReport);
+    if (!out.is_open())
+    {
+        printf("Error: Could not open cost report file %s\n", options.costReport.c_str());
+        return false;
+    }
+    if (options.costJson)
+    {
+        model.writeJson(out);
+        return true;
+    }
+
+    std::vector<std::string> sourceLines;
+    if (options.inputFile)
+    {
+        std::ifstream source(options.inputFile);
+        std::string line;
+        while (std::getline(source, line))
+        {
+            sourceLines.push_back(line);
+        }
+    }
+    model.writeAnnotatedSource(out, sourceLines);
+    return true;
+}
+
+// Отчеты генератора после кода: регистры, выполнение при компиляции, проходы
+static void printReports(const CodeGenerator &generator, const Options &options)
+{
+    printf("\n=== Register Promotion ===\n");
+    generator.printPromotionReport(std::cout);
+
+    if (options.precomputeSteps > 0)
+    {
+        printf("\n=== Compile-Time Execution ===\n");
+        generator.printPrecomputeReport(std::cout);
+    }
+
+    if (options.passStats)
+    {
+        printf("\n=== Pass Statistics ===\n");
+        generator.printPassReport(std::cout);
+    }
+}
 
 int main(int argc, char *argv[])
 {
-    // Инициализируем корень AST
-    root.reset();
+    Options options;
+    if (!parseOptions(argc, argv, options))
+    {
+        return 1;
+    }
+    if (options.help)
+    {
+        printUsage(argv[0]);
+        return 0;
+    }
+
+    // Парсер строит дерево в этот AST
+    Ast ast;
+    parse_ast = &ast;
 
     // Включаем отладку парсера
     // yydebug = 1;
 
     // Если передан входной файл
-    if (argc > 1)
+    if (options.inputFile)
     {
-        yyin = fopen(argv[1], "r");
+        yyin = fopen(options.inputFile, "r");
         if (!yyin)
         {
-            printf("Error: Could not open input file %s\n", argv[1]);
+            printf("Error: Could not open input file %s\n", options.inputFile);
             return 1;
         }
-        printf("Opened file: %s\n", argv[1]);
+        printf("Opened file: %s\n", options.inputFile);
     }
 
     printf("Starting parsing...\n");
-    int res = yyparse();
+    auto parseStart = std::chrono::steady_clock::now();
+    int res;
+    size_t tokenCount;
+    if (options.handParser)
+    {
+        // Чтение файла входит в замер: Bison читает его по ходу разбора
+        std::string source = readInput(yyin ? yyin : stdin);
+        PrattParser parser(source, ast);
+        res = parser.parse() ? 0 : 1;
+        tokenCount = parser.tokens();
+    }
+    else
+    {
+        res = yyparse();
+        tokenCount = parse_token_count;
+    }
+    double parseSeconds =
+        std::chrono::duration<double>(std::chrono::steady_clock::now() - parseStart).count();
     printf("Parsing result: %d\n", res);
 
     // Закрываем входной файл
-    if (argc > 1 && yyin)
+    if (options.inputFile && yyin)
     {
         fclose(yyin);
     }
 
-    // Переносим владение из parsed_program в root
-    if (res == 0 && parsed_program != nullptr)
+    if (options.parseStats)
     {
-        root.reset(parsed_program);
-        parsed_program = nullptr;
+        printf("Parse statistics (%s): %zu tokens, %zu nodes, %.3f ms, %.2f M tokens/s, "
+               "%.2f M nodes/s\n",
+               options.handParser ? "hand" : "bison", tokenCount, ast.size(), parseSeconds * 1e3,
+               tokenCount / parseSeconds / 1e6, ast.size() / parseSeconds / 1e6);
+
+        // Память массивов дерева и время его освобождения
+        size_t nodeCount = ast.size();
+        size_t astBytes = ast.memoryUsage();
+        auto clearStart = std::chrono::steady_clock::now();
+        ast.clear();
+        double clearSeconds =
+            std::chrono::duration<double>(std::chrono::steady_clock::now() - clearStart).count();
+        printf("AST statistics: %zu nodes, %zu bytes, %.1f bytes/node, teardown %.3f ms\n",
+               nodeCount, astBytes, nodeCount ? static_cast<double>(astBytes) / nodeCount : 0.0,
+               clearSeconds * 1e3);
+        return res;
     }
 
-    if (res == 0 && root)
+    if (res == 0 && ast.root() != NO_NODE)
     {
         printf("Parsing completed successfully.\n");
 
         // Визуализация AST
         printf("\n=== AST ===\n");
-        root->print();
+        ast.print();
 
-        // Генерация кода
+        // Генерация кода в файл или в stdout
         printf("\n=== Generated RISC-V Assembly ===\n");
-        if (argc > 2)
+        std::ofstream outFile;
+        if (options.outputFile)
         {
-            // Если задан файл для вывода
-            std::ofstream outFile(argv[2]);
-            if (outFile.is_open())
+            outFile.open(options.outputFile);
+            if (!outFile.is_open())
             {
-                CodeGenerator generator(outFile);
-                generator.generateCode(*root);
-                outFile.close();
-                printf("Assembly code written to %s\n", argv[2]);
-            }
-            else
-            {
-                printf("Error: Could not open output file %s\n", argv[2]);
+                printf("Error: Could not open output file %s\n", options.outputFile);
                 return 1;
             }
         }
-        else
+        CostModel costModel;
+        CodeGenerator generator(options.outputFile ? static_cast<std::ostream &>(outFile) : std::cout);
+        if (!configureGenerator(generator, options))
+        {
+            return 1;
+        }
+        if (!options.costReport.empty())
+        {
+            generator.setCostModel(&costModel);
+        }
+        generator.generateCode(ast);
+        if (options.outputFile)
         {
-            // Выводим в stdout
-            CodeGenerator generator(std::cout);
-            generator.generateCode(*root);
+            outFile.close();
+            printf("Assembly code written to %s\n", options.outputFile);
+        }
+
+        printReports(generator, options);
+
+        if (!options.costReport.empty())
+        {
+            if (!writeCostReport(costModel, options))
+            {
+                return 1;
+            }
+            printf("Cost report written to %s\n", options.costReport.c_str());
         }
     }
     else
@@ -2,28 +2,39 @@
 #include "ast.hpp"
 #include <cstdio>
 #include <cstdlib>
-#include <memory>
 #include <string>
-
-// Forward declarations
-class ASTNode;
-class ProgramNode;
+#include <vector>
 
 extern int yylineno;
 void yyerror(const char* s);
 extern int yylex();
 
-// External reference to the parsed program
-extern ProgramNode* parsed_program;
+// Число токенов, прочитанных парсером (для --parse-stats)
+size_t parse_token_count = 0;
+static int countedLex()
+{
+    int token = yylex();
+    parse_token_count += token != 0;
+    return token;
+}
+#define yylex countedLex
 %}
 
+// Типы значений нужны и в parser.tab.h, который подключает лексер
+%code requires {
+#include "ast.hpp"
+#include <vector>
+}
+
 %union {
     int int_val;
     char* str_val;
-    void* node;
+    NodeId node;
+    std::vector<NodeId>* list;
 }
 
 %define parse.error verbose
+%locations
 
 %token <int_val> INTEGER
 %token <str_val> STRING
@@ -35,7 +46,12 @@ extern ProgramNode* parsed_program;
 %token PLUS MINUS MUL DIV ASSIGN
 %token SEMI LBRACE RBRACE LPAREN RPAREN
 
-%type <node> statement expr program statement_list
+%type <node> statement expr
+%type <list> program statement_list
+
+// Списки операторов собираются во временных векторах и переносятся
+// в массив списков AST, когда блок закрыт
+%destructor { delete $$; } <list>
 
 %left OR
 %left AND
@@ -47,126 +63,132 @@ extern ProgramNode* parsed_program;
 
 %%
 
+translation_unit:
+      program {
+        parse_ast->setRoot(parse_ast->program(*$1));
+        delete $1;
+      }
+    ;
+
 program:
       statement { 
-        if ($1 != nullptr) {
-          $$ = (void*)new ProgramNode(); 
-          ((ProgramNode*)$$)->addStatement(std::unique_ptr<ASTNode>((ASTNode*)$1));
-          parsed_program = (ProgramNode*)$$;
-        } else {
-          YYERROR;
-        }
+        $$ = new std::vector<NodeId>();
+        $$->push_back($1);
       }
     | program statement { 
-        if ($1 != nullptr && $2 != nullptr) {
-          ((ProgramNode*)$1)->addStatement(std::unique_ptr<ASTNode>((ASTNode*)$2)); 
-          $$ = $1; 
-          parsed_program = (ProgramNode*)$$;
-        } else {
-          YYERROR;
-        }
+        $1->push_back($2);
+        $$ = $1; 
       }
     ;
 
 statement:
       INT_TYPE IDENTIFIER SEMI { 
-        $$ = (void*)new VarDeclNode(VarType::INT, std::string($2)); 
+        $$ = parse_ast->varDecl(VarType::INT, std::string($2)); 
+        parse_ast->setLine($$, @1.first_line);
         free($2);
       }
     | STRING_TYPE IDENTIFIER SEMI { 
-        $$ = (void*)new VarDeclNode(VarType::STRING, std::string($2)); 
+        $$ = parse_ast->varDecl(VarType::STRING, std::string($2)); 
+        parse_ast->setLine($$, @1.first_line);
         free($2);
       }
     | IDENTIFIER ASSIGN expr SEMI { 
-        auto* assign_node = new AssignNode(std::string($1), std::unique_ptr<ASTNode>((ASTNode*)$3));
-        $$ = (void*)assign_node;
+        $$ = parse_ast->assign(std::string($1), $3);
+        parse_ast->setLine($$, @1.first_line);
         free($1);
       }
     | PRINT expr SEMI { 
-        $$ = (void*)new PrintNode(std::unique_ptr<ASTNode>((ASTNode*)$2)); 
+        $$ = parse_ast->printStmt($2); 
+        parse_ast->setLine($$, @1.first_line);
       }
     | IF LPAREN expr RPAREN statement { 
-        $$ = (void*)new IfNode(std::unique_ptr<ASTNode>((ASTNode*)$3), std::unique_ptr<ASTNode>((ASTNode*)$5)); 
+        $$ = parse_ast->ifStmt($3, $5); 
+        parse_ast->setLine($$, @1.first_line);
       }
     | IF LPAREN expr RPAREN statement ELSE statement { 
-        $$ = (void*)new IfNode(std::unique_ptr<ASTNode>((ASTNode*)$3), std::unique_ptr<ASTNode>((ASTNode*)$5), std::unique_ptr<ASTNode>((ASTNode*)$7)); 
+        $$ = parse_ast->ifStmt($3, $5, $7); 
+        parse_ast->setLine($$, @1.first_line);
       }
     | WHILE LPAREN expr RPAREN statement { 
-        $$ = (void*)new WhileNode(std::unique_ptr<ASTNode>((ASTNode*)$3), std::unique_ptr<ASTNode>((ASTNode*)$5)); 
+        $$ = parse_ast->whileStmt($3, $5); 
+        parse_ast->setLine($$, @1.first_line);
       }
     | LBRACE statement_list RBRACE { 
-        $$ = $2;  // statement_list уже возвращает BlockNode
+        $$ = parse_ast->block(*$2);
+        parse_ast->setLine($$, @1.first_line);
+        delete $2;
       }
     ;
 
 statement_list:
       /* empty */ {
-        $$ = (void*)new BlockNode();
+        $$ = new std::vector<NodeId>();
       }
     | statement_list statement {
-        ((BlockNode*)$1)->addStatement(std::unique_ptr<ASTNode>((ASTNode*)$2));
+        $1->push_back($2);
         $$ = $1;
       }
     ;
 
 expr:
       expr PLUS expr { 
-        $$ = (void*)new BinaryOpNode(BinOpType::PLUS, std::unique_ptr<ASTNode>((ASTNode*)$1), std::unique_ptr<ASTNode>((ASTNode*)$3)); 
+        $$ = parse_ast->binaryOp(BinOpType::PLUS, $1, $3); 
       }
     | expr MINUS expr { 
-        $$ = (void*)new BinaryOpNode(BinOpType::MINUS, std::unique_ptr<ASTNode>((ASTNode*)$1), std::unique_ptr<ASTNode>((ASTNode*)$3)); 
+        $$ = parse_ast->binaryOp(BinOpType::MINUS, $1, $3); 
       }
     | expr MUL expr { 
-        $$ = (void*)new BinaryOpNode(BinOpType::MUL, std::unique_ptr<ASTNode>((ASTNode*)$1), std::unique_ptr<ASTNode>((ASTNode*)$3)); 
+        $$ = parse_ast->binaryOp(BinOpType::MUL, $1, $3); 
       }
     | expr DIV expr { 
-        $$ = (void*)new BinaryOpNode(BinOpType::DIV, std::unique_ptr<ASTNode>((ASTNode*)$1), std::unique_ptr<ASTNode>((ASTNode*)$3)); 
+        $$ = parse_ast->binaryOp(BinOpType::DIV, $1, $3); 
       }
     | expr EQ expr { 
-        $$ = (void*)new BinaryOpNode(BinOpType::EQ, std::unique_ptr<ASTNode>((ASTNode*)$1), std::unique_ptr<ASTNode>((ASTNode*)$3)); 
+        $$ = parse_ast->binaryOp(BinOpType::EQ, $1, $3); 
       }
     | expr NEQ expr { 
-        $$ = (void*)new BinaryOpNode(BinOpType::NEQ, std::unique_ptr<ASTNode>((ASTNode*)$1), std::unique_ptr<ASTNode>((ASTNode*)$3)); 
+        $$ = parse_ast->binaryOp(BinOpType::NEQ, $1, $3); 
       }
     | expr LE expr { 
-        $$ = (void*)new BinaryOpNode(BinOpType::LE, std::unique_ptr<ASTNode>((ASTNode*)$1), std::unique_ptr<ASTNode>((ASTNode*)$3)); 
+        $$ = parse_ast->binaryOp(BinOpType::LE, $1, $3); 
       }
     | expr GE expr { 
-        $$ = (void*)new BinaryOpNode(BinOpType::GE, std::unique_ptr<ASTNode>((ASTNode*)$1), std::unique_ptr<ASTNode>((ASTNode*)$3)); 
+        $$ = parse_ast->binaryOp(BinOpType::GE, $1, $3); 
       }
     | expr LT expr { 
-        $$ = (void*)new BinaryOpNode(BinOpType::LT, std::unique_ptr<ASTNode>((ASTNode*)$1), std::unique_ptr<ASTNode>((ASTNode*)$3)); 
+        $$ = parse_ast->binaryOp(BinOpType::LT, $1, $3); 
       }
     | expr GT expr { 
-        $$ = (void*)new BinaryOpNode(BinOpType::GT, std::unique_ptr<ASTNode>((ASTNode*)$1), std::unique_ptr<ASTNode>((ASTNode*)$3)); 
+        $$ = parse_ast->binaryOp(BinOpType::GT, $1, $3); 
       }
     | expr AND expr { 
-        $$ = (void*)new BinaryOpNode(BinOpType::AND, std::unique_ptr<ASTNode>((ASTNode*)$1), std::unique_ptr<ASTNode>((ASTNode*)$3)); 
+        $$ = parse_ast->binaryOp(BinOpType::AND, $1, $3); 
       }
     | expr OR expr { 
-        $$ = (void*)new BinaryOpNode(BinOpType::OR, std::unique_ptr<ASTNode>((ASTNode*)$1), std::unique_ptr<ASTNode>((ASTNode*)$3)); 
+        $$ = parse_ast->binaryOp(BinOpType::OR, $1, $3); 
       }
     | NOT expr { 
-        $$ = (void*)new UnaryOpNode(std::unique_ptr<ASTNode>((ASTNode*)$2)); 
+        $$ = parse_ast->unaryOp($2); 
       }
     | LPAREN expr RPAREN { 
         $$ = $2; 
       }
     | INTEGER { 
-        $$ = (void*)new IntLiteralNode($1); 
+        $$ = parse_ast->intLiteral($1); 
       }
     | STRING { 
-        $$ = (void*)new StringLiteralNode(std::string($1)); 
+        $$ = parse_ast->stringLiteral(std::string($1)); 
         free($1);
       }
     | IDENTIFIER { 
-        $$ = (void*)new IdentifierNode(std::string($1)); 
+        $$ = parse_ast->identifier(std::string($1)); 
         free($1);
       }
     ;
 
 %%
 
+
 void yyerror(const char* s) {
     fprintf(stderr, "Parser error at line %d: %s\n", yylineno, s);
 }
@@ -0,0 +1,201 @@
+#include "passes.hpp"
+#include <chrono>
+#include <cstdio>
+#include <sstream>
+
+// Наборы проходов уровней оптимизации. -O1 - дешевые проходы без общих
+// подвыражений и размещения блоков, -Os - набор -O2 с оценкой по размеру
+struct OptimizationLevel
+{
+    const char *flag;
+    const char *passes;
+    bool forSize;
+};
+static const OptimizationLevel LEVELS[] = {
+    {"-O0", "", false},
+    {"-O1", "promote,thread-jumps,remove-unreachable,merge-blocks", false},
+    {"-O2", "promote,cse,thread-jumps,remove-unreachable,merge-blocks,layout", false},
+    {"-Os", "promote,cse,thread-jumps,remove-unreachable,merge-blocks,layout", true},
+};
+
+static double secondsSince(std::chrono::steady_clock::time_point start)
+{
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+int PassManager::find(const std::string &name) const
+{
+    for (size_t i = 0; i < passes.size(); ++i)
+    {
+        if (passes[i].name == name)
+        {
+            return static_cast<int>(i);
+        }
+    }
+    return -1;
+}
+
+void PassManager::addPass(const std::string &name, PassStage stage, std::vector<Analysis> required,
+                          std::vector<Analysis> invalidated, const std::string &unit,
+                          PassFunction run)
+{
+    passes.push_back({name, stage, std::move(required), std::move(invalidated), unit, std::move(run)});
+}
+
+void PassManager::addAnalysis(Analysis analysis, const std::string &name,
+                              std::function<void()> compute)
+{
+    AnalysisState &state = analyses[static_cast<int>(analysis)];
+    state.name = name;
+    state.compute = std::move(compute);
+}
+
+bool PassManager::setLevel(const std::string &level)
+{
+    for (const auto &preset : LEVELS)
+    {
+        if (level == preset.flag)
+        {
+            std::string error;
+            setPipeline(preset.passes, error);
+            pipelineSource = preset.flag;
+            optimizeForSize = preset.forSize;
+            return true;
+        }
+    }
+    return false;
+}
+
+bool PassManager::setPipeline(const std::string &list, std::string &error)
+{
+    std::vector<size_t> names;
+    std::istringstream in(list);
+    std::string name;
+    bool sawCfgPass = false;
+    while (std::getline(in, name, ','))
+    {
+        if (name.empty())
+        {
+            continue;
+        }
+        int index = find(name);
+        if (index < 0)
+        {
+            error = "unknown pass " + name;
+            return false;
+        }
+        // Проходы AST нужны генератору до построения графа
+        if (passes[index].stage == PassStage::AST && sawCfgPass)
+        {
+            error = "pass " + name + " works on the AST and must precede CFG passes";
+            return false;
+        }
+        sawCfgPass = sawCfgPass || passes[index].stage == PassStage::CFG;
+        names.push_back(static_cast<size_t>(index));
+    }
+    pipeline = names;
+    pipelineSource = "--passes";
+    return true;
+}
+
+bool PassManager::enabled(const std::string &name) const
+{
+    for (size_t index : pipeline)
+    {
+        if (passes[index].name == name)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+void PassManager::require(Analysis analysis)
+{
+    AnalysisState &state = analyses[static_cast<int>(analysis)];
+    if (state.valid)
+    {
+        state.reused++;
+        return;
+    }
+    auto start = std::chrono::steady_clock::now();
+    state.compute();
+    state.seconds += secondsSince(start);
+    state.computed++;
+    state.valid = true;
+}
+
+void PassManager::run(PassStage stage)
+{
+    for (size_t index : pipeline)
+    {
+        const Pass &pass = passes[index];
+        if (pass.stage != stage)
+        {
+            continue;
+        }
+        for (Analysis analysis : pass.required)
+        {
+            require(analysis);
+        }
+
+        // Время анализов учитывается отдельно от времени прохода
+        auto start = std::chrono::steady_clock::now();
+        int changes = pass.run();
+        records.push_back({pass.name, stage == PassStage::AST ? "ast" : "cfg",
+                           secondsSince(start), changes, pass.unit});
+
+        // Проход без изменений сохраняет все анализы
+        if (changes > 0)
+        {
+            for (Analysis analysis : pass.invalidated)
+            {
+                analyses[static_cast<int>(analysis)].valid = false;
+            }
+        }
+    }
+}
+
+void PassManager::runPhase(const std::string &name, const std::function<void()> &phase)
+{
+    auto start = std::chrono::steady_clock::now();
+    phase();
+    records.push_back({name, "-", secondsSince(start), -1, ""});
+}
+
+void PassManager::writeReport(std::ostream &out) const
+{
+    std::string list;
+    for (size_t index : pipeline)
+    {
+        list += (list.empty() ? "" : ",") + passes[index].name;
+    }
+    out << "Pipeline (" << pipelineSource << "): " << (list.empty() ? "(none)" : list) << "\n";
+
+    char row[256];
+    double total = 0;
+    snprintf(row, sizeof(row), "  %-20s %5s %10s  %s\n", "pass", "stage", "time ms", "changes");
+    out << row;
+    for (const auto &record : records)
+    {
+        std::string changes =
+            record.changes < 0 ? "" : std::to_string(record.changes) + " " + record.unit;
+        snprintf(row, sizeof(row), "  %-20s %5s %10.3f  %s\n", record.name.c_str(), record.stage,
+                 record.seconds * 1e3, changes.c_str());
+        out << row;
+        total += record.seconds;
+    }
+    for (const auto &state : analyses)
+    {
+        if (state.computed == 0 && state.reused == 0)
+        {
+            continue;
+        }
+        snprintf(row, sizeof(row), "  %-20s %5s %10.3f  computed %d, reused %d\n",
+                 state.name.c_str(), "an", state.seconds * 1e3, state.computed, state.reused);
+        out << row;
+        total += state.seconds;
+    }
+    snprintf(row, sizeof(row), "  %-20s %5s %10.3f\n", "total", "", total * 1e3);
+    out << row;
+}
@@ -0,0 +1,94 @@
+#ifndef PASSES_HPP
+#define PASSES_HPP
+
+#include <functional>
+#include <ostream>
+#include <string>
+#include <vector>
+
+// Когда выполняется проход: до генерации кода (решения, которые генератор
+// использует при обходе AST) или над графом блоков после нее
+enum class PassStage
+{
+    AST,
+    CFG
+};
+
+// Анализы, результаты которых переиспользуются проходами. Результат хранит
+// генератор, менеджер следит, актуален ли он
+enum class Analysis
+{
+    VALUE_NUMBERING, // общие подвыражения (ValueNumbering)
+    REACHABILITY,    // достижимые из входа блоки
+    PREDECESSORS     // число предшественников у блоков
+};
+const int ANALYSIS_COUNT = 3;
+
+// Менеджер проходов: набор проходов по уровню -O или списку --passes,
+// вычисление анализов по требованию, их кэширование и сброс после
+// изменивших что-то проходов, время и число изменений каждого прохода
+class PassManager
+{
+public:
+    typedef std::function<int()> PassFunction; // возвращает число изменений
+
+private:
+    struct Pass
+    {
+        std::string name;
+        PassStage stage;
+        std::vector<Analysis> required;
+        std::vector<Analysis> invalidated; // устаревают, если проход что-то изменил
+        std::string unit;                  // что считается изменением
+        PassFunction run;
+    };
+    struct AnalysisState
+    {
+        std::string name;
+        std::function<void()> compute;
+        bool valid = false;
+        int computed = 0;
+        int reused = 0;
+        double seconds = 0;
+    };
+    struct Record
+    {
+        std::string name;
+        const char *stage; // "ast", "cfg" или "-" для обязательной фазы
+        double seconds;
+        int changes;       // -1 у обязательной фазы
+        std::string unit;
+    };
+
+    std::vector<Pass> passes;
+    std::vector<size_t> pipeline; // номера проходов в порядке выполнения
+    std::string pipelineSource;   // "-O2" или "--passes"
+    bool optimizeForSize;
+    AnalysisState analyses[ANALYSIS_COUNT];
+    std::vector<Record> records;
+
+    int find(const std::string &name) const;
+    void require(Analysis analysis);
+
+public:
+    PassManager() : pipelineSource("-O2"), optimizeForSize(false) {}
+
+    void addPass(const std::string &name, PassStage stage, std::vector<Analysis> required,
+                 std::vector<Analysis> invalidated, const std::string &unit, PassFunction run);
+    void addAnalysis(Analysis analysis, const std::string &name, std::function<void()> compute);
+
+    // -O0, -O1, -O2, -Os; false - неизвестный уровень
+    bool setLevel(const std::string &level);
+    // --passes=a,b,c: проходы AST идут раньше проходов графа, повторы разрешены
+    bool setPipeline(const std::string &list, std::string &error);
+    bool enabled(const std::string &name) const;
+    // -Os: проходы оценивают размер кода, а не число выполненных инструкций
+    bool forSize() const { return optimizeForSize; }
+
+    void run(PassStage stage);
+    void runPhase(const std::string &name, const std::function<void()> &phase);
+
+    void writeReport(std::ostream &out) const;
+};
+
+#endif // PASSES_HPP
@@ -0,0 +1,397 @@
+#include "pratt.hpp"
+#include <cstdio>
+#include <vector>
+
+// Предел вложенности скобок, not и операторов: глубже рекурсия рискует
+// переполнить стек (у Bison такой же предел - YYMAXDEPTH)
+static const int MAX_NESTING = 10000;
+
+// Приоритеты как в %left parser.y: чем больше, тем сильнее связывает
+static const int NOT_PRECEDENCE = 7;
+
+static int binaryPrecedence(TokenKind kind, BinOpType &op)
+{
+    switch (kind)
+    {
+    case TokenKind::OR:
+        op = BinOpType::OR;
+        return 1;
+    case TokenKind::AND:
+        op = BinOpType::AND;
+        return 2;
+    case TokenKind::EQ:
+        op = BinOpType::EQ;
+        return 3;
+    case TokenKind::NEQ:
+        op = BinOpType::NEQ;
+        return 3;
+    case TokenKind::LT:
+        op = BinOpType::LT;
+        return 4;
+    case TokenKind::LE:
+        op = BinOpType::LE;
+        return 4;
+    case TokenKind::GT:
+        op = BinOpType::GT;
+        return 4;
+    case TokenKind::GE:
+        op = BinOpType::GE;
+        return 4;
+    case TokenKind::PLUS:
+        op = BinOpType::PLUS;
+        return 5;
+    case TokenKind::MINUS:
+        op = BinOpType::MINUS;
+        return 5;
+    case TokenKind::MUL:
+        op = BinOpType::MUL;
+        return 6;
+    case TokenKind::DIV:
+        op = BinOpType::DIV;
+        return 6;
+    default:
+        return 0; // не бинарная операция - выражение закончилось
+    }
+}
+
+// Возврат из узла рекурсии уменьшает глубину вложенности
+struct NestingLevel
+{
+    int &depth;
+    ~NestingLevel() { --depth; }
+};
+
+bool PrattParser::accept(TokenKind kind)
+{
+    if (current.kind != kind)
+    {
+        return false;
+    }
+    advance();
+    return true;
+}
+
+bool PrattParser::expect(TokenKind kind)
+{
+    if (accept(kind))
+    {
+        return true;
+    }
+    error(tokenName(kind));
+    return false;
+}
+
+void PrattParser::error(const char *expecting)
+{
+    if (aborted)
+    {
+        return;
+    }
+    ++errors;
+    fprintf(stderr, "Parser error at line %u: syntax error, unexpected %s", current.line,
+            tokenName(current.kind));
+    if (expecting)
+    {
+        fprintf(stderr, ", expecting %s", expecting);
+    }
+    fputc('\n', stderr);
+}
+
+bool PrattParser::enter()
+{
+    if (aborted)
+    {
+        return false;
+    }
+    if (depth >= MAX_NESTING)
+    {
+        ++errors;
+        fprintf(stderr, "Parser error at line %u: nesting too deep\n", current.line);
+        aborted = true;
+        return false;
+    }
+    ++depth;
+    return true;
+}
+
+void PrattParser::synchronize()
+{
+    // Пропускаем остаток ошибочного оператора
+    while (!aborted && current.kind != TokenKind::END)
+    {
+        switch (current.kind)
+        {
+        case TokenKind::SEMI:
+            advance();
+            return;
+        case TokenKind::LBRACE:
+        case TokenKind::RBRACE:
+        case TokenKind::INT_TYPE:
+        case TokenKind::STRING_TYPE:
+        case TokenKind::IF:
+        case TokenKind::WHILE:
+        case TokenKind::PRINT:
+            return;
+        default:
+            advance();
+            break;
+        }
+    }
+}
+
+bool PrattParser::parse()
+{
+    advance();
+    std::vector<NodeId> statements;
+    while (!aborted && current.kind != TokenKind::END)
+    {
+        if (current.kind == TokenKind::RBRACE)
+        {
+            error(nullptr);
+            advance();
+            continue;
+        }
+        NodeId statement = parseStatement();
+        if (statement != NO_NODE)
+        {
+            statements.push_back(statement);
+        }
+        else
+        {
+            synchronize();
+        }
+    }
+
+    // В parser.y программа - хотя бы один оператор
+    if (statements.empty() && errors == 0)
+    {
+        error(nullptr);
+    }
+    if (errors > 0)
+    {
+        return false;
+    }
+    ast.setRoot(ast.program(statements));
+    return true;
+}
+
+NodeId PrattParser::parseStatement()
+{
+    if (!enter())
+    {
+        return NO_NODE;
+    }
+    NestingLevel level{depth};
+
+    // Узел оператора создается после всех его потомков, как в parser.y
+    uint32_t line = current.line;
+    NodeId id = NO_NODE;
+    switch (current.kind)
+    {
+    case TokenKind::INT_TYPE:
+    case TokenKind::STRING_TYPE:
+    {
+        VarType type = current.kind == TokenKind::INT_TYPE ? VarType::INT : VarType::STRING;
+        advance();
+        if (current.kind != TokenKind::IDENTIFIER)
+        {
+            error(tokenName(TokenKind::IDENTIFIER));
+            return NO_NODE;
+        }
+        std::string name = scanner.text(current);
+        advance();
+        if (!expect(TokenKind::SEMI))
+        {
+            return NO_NODE;
+        }
+        id = ast.varDecl(type, name);
+        break;
+    }
+    case TokenKind::IDENTIFIER:
+    {
+        std::string name = scanner.text(current);
+        advance();
+        if (!expect(TokenKind::ASSIGN))
+        {
+            return NO_NODE;
+        }
+        NodeId value = parseExpression(1);
+        if (value == NO_NODE || !expect(TokenKind::SEMI))
+        {
+            return NO_NODE;
+        }
+        id = ast.assign(name, value);
+        break;
+    }
+    case TokenKind::PRINT:
+    {
+        advance();
+        NodeId value = parseExpression(1);
+        if (value == NO_NODE || !expect(TokenKind::SEMI))
+        {
+            return NO_NODE;
+        }
+        id = ast.printStmt(value);
+        break;
+    }
+    case TokenKind::IF:
+    {
+        // else относится к ближайшему if, как при сдвиге в Bison
+        advance();
+        NodeId condition = parseCondition();
+        if (condition == NO_NODE)
+        {
+            return NO_NODE;
+        }
+        NodeId thenStmt = parseStatement();
+        if (thenStmt == NO_NODE)
+        {
+            return NO_NODE;
+        }
+        NodeId elseStmt = NO_NODE;
+        if (accept(TokenKind::ELSE))
+        {
+            elseStmt = parseStatement();
+            if (elseStmt == NO_NODE)
+            {
+                return NO_NODE;
+            }
+        }
+        id = ast.ifStmt(condition, thenStmt, elseStmt);
+        break;
+    }
+    case TokenKind::WHILE:
+    {
+        advance();
+        NodeId condition = parseCondition();
+        if (condition == NO_NODE)
+        {
+            return NO_NODE;
+        }
+        NodeId body = parseStatement();
+        if (body == NO_NODE)
+        {
+            return NO_NODE;
+        }
+        id = ast.whileStmt(condition, body);
+        break;
+    }
+    case TokenKind::LBRACE:
+        advance();
+        return parseBlock(line);
+    default:
+        error(nullptr);
+        return NO_NODE;
+    }
+    ast.setLine(id, static_cast<int>(line));
+    return id;
+}
+
+NodeId PrattParser::parseBlock(uint32_t line)
+{
+    // Ошибочные операторы пропускаются, разбор блока продолжается
+    std::vector<NodeId> statements;
+    while (!aborted && current.kind != TokenKind::RBRACE && current.kind != TokenKind::END)
+    {
+        NodeId statement = parseStatement();
+        if (statement != NO_NODE)
+        {
+            statements.push_back(statement);
+        }
+        else
+        {
+            synchronize();
+        }
+    }
+    if (!expect(TokenKind::RBRACE))
+    {
+        return NO_NODE;
+    }
+    NodeId id = ast.block(statements);
+    ast.setLine(id, static_cast<int>(line));
+    return id;
+}
+
+NodeId PrattParser::parseCondition()
+{
+    if (!expect(TokenKind::LPAREN))
+    {
+        return NO_NODE;
+    }
+    NodeId condition = parseExpression(1);
+    if (condition == NO_NODE || !expect(TokenKind::RPAREN))
+    {
+        return NO_NODE;
+    }
+    return condition;
+}
+
+NodeId PrattParser::parseExpression(int minPrecedence)
+{
+    if (!enter())
+    {
+        return NO_NODE;
+    }
+    NestingLevel level{depth};
+
+    // Операции одного приоритета левоассоциативны: правый операнд
+    // забирает только операции с большим приоритетом
+    NodeId left = parsePrimary();
+    while (left != NO_NODE)
+    {
+        BinOpType op = BinOpType::PLUS;
+        int precedence = binaryPrecedence(current.kind, op);
+        if (precedence < minPrecedence)
+        {
+            break;
+        }
+        advance();
+        NodeId right = parseExpression(precedence + 1);
+        if (right == NO_NODE)
+        {
+            return NO_NODE;
+        }
+        left = ast.binaryOp(op, left, right);
+    }
+    return left;
+}
+
+NodeId PrattParser::parsePrimary()
+{
+    NodeId id = NO_NODE;
+    switch (current.kind)
+    {
+    case TokenKind::INTEGER:
+        id = ast.intLiteral(current.value);
+        advance();
+        return id;
+    case TokenKind::STRING:
+        id = ast.stringLiteral(scanner.text(current));
+        advance();
+        return id;
+    case TokenKind::IDENTIFIER:
+        id = ast.identifier(scanner.text(current));
+        advance();
+        return id;
+    case TokenKind::NOT:
+    {
+        // not связывает сильнее любой бинарной операции
+        advance();
+        NodeId operand = parseExpression(NOT_PRECEDENCE);
+        return operand != NO_NODE ? ast.unaryOp(operand) : NO_NODE;
+    }
+    case TokenKind::LPAREN:
+    {
+        advance();
+        NodeId inner = parseExpression(1);
+        if (inner == NO_NODE || !expect(TokenKind::RPAREN))
+        {
+            return NO_NODE;
+        }
+        return inner;
+    }
+    default:
+        error(nullptr);
+        return NO_NODE;
+    }
+}
@@ -0,0 +1,50 @@
+#ifndef PRATT_HPP
+#define PRATT_HPP
+
+#include "ast.hpp"
+#include "scanner.hpp"
+#include <string>
+
+// Синтаксический анализатор, написанный вручную (--parser=hand): операторы
+// разбираются рекурсивным спуском, выражения - по приоритетам операций
+// (Pratt). Строит то же дерево, что parser.y: узлы создаются в том же
+// порядке, поэтому совпадают и номера узлов.
+//
+// После синтаксической ошибки анализатор пропускает токены до конца
+// оператора (';', '}' или начала следующего оператора) и продолжает
+// разбор, так что за один запуск выводятся все ошибки файла.
+class PrattParser
+{
+private:
+    Scanner scanner;
+    Ast &ast;
+    Token current;
+    int errors;
+    int depth;     // вложенность операторов и скобок
+    bool aborted;  // вложенность превысила предел, разбор остановлен
+
+    void advance() { current = scanner.next(); }
+    bool accept(TokenKind kind);
+    bool expect(TokenKind kind);
+    void error(const char *expecting);
+    bool enter();
+    void synchronize();
+
+    NodeId parseStatement();
+    NodeId parseBlock(uint32_t line);
+    NodeId parseCondition();
+    NodeId parseExpression(int minPrecedence);
+    NodeId parsePrimary();
+
+public:
+    PrattParser(const std::string &source, Ast &tree)
+        : scanner(source), ast(tree), current(), errors(0), depth(0), aborted(false) {}
+
+    // true, если ошибок нет; тогда корень дерева установлен
+    bool parse();
+
+    int errorCount() const { return errors; }
+    size_t tokens() const { return scanner.tokens(); }
+};
+
+#endif // PRATT_HPP
@@ -0,0 +1,297 @@
+#include "precompute.hpp"
+#include "runtime.hpp"
+
+ProgramEvaluator::Variable &ProgramEvaluator::variable(NodeId id)
+{
+    // Номер интернированного имени - индекс в таблице переменных
+    uint32_t index = ast->node(id).a;
+    if (index >= variables.size())
+    {
+        variables.resize(index + 1);
+    }
+    Variable &var = variables[index];
+    if (!var.known)
+    {
+        auto it = types.find(ast->name(id));
+        var.known = true;
+        var.declared = it != types.end();
+        var.type = var.declared ? it->second : VarType::INT;
+    }
+    return var;
+}
+
+bool ProgramEvaluator::fail(const std::string &reason)
+{
+    failure = reason;
+    return false;
+}
+
+bool ProgramEvaluator::step()
+{
+    if (++stepCount > stepBudget)
+    {
+        return fail("step budget of " + std::to_string(stepBudget) + " exceeded");
+    }
+    return true;
+}
+
+bool ProgramEvaluator::run()
+{
+    result.clear();
+    failure.clear();
+    stepCount = 0;
+    for (NodeId stmt : ast->statements(ast->root()))
+    {
+        if (!execute(stmt))
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool ProgramEvaluator::execute(NodeId id)
+{
+    if (!step())
+    {
+        return false;
+    }
+    switch (ast->kind(id))
+    {
+    case NodeKind::VAR_DECL:
+        // Объявление не порождает кода и не сбрасывает значение
+        return true;
+    case NodeKind::ASSIGN:
+    {
+        Variable &var = variable(id);
+        if (!var.declared)
+        {
+            return fail("undeclared variable " + ast->name(id));
+        }
+        Value value;
+        if (!evaluate(ast->expression(id), value))
+        {
+            return false;
+        }
+        variable(id).value = value; // таблица могла вырасти при вычислении
+        return true;
+    }
+    case NodeKind::PRINT:
+        return print(ast->expression(id));
+    case NodeKind::IF:
+    {
+        int32_t condition;
+        if (!evaluateInt(ast->condition(id), condition))
+        {
+            return false;
+        }
+        if (condition != 0)
+        {
+            return execute(ast->thenStmt(id));
+        }
+        return ast->elseStmt(id) == NO_NODE || execute(ast->elseStmt(id));
+    }
+    case NodeKind::WHILE:
+        for (;;)
+        {
+            int32_t condition;
+            if (!evaluateInt(ast->condition(id), condition))
+            {
+                return false;
+            }
+            if (condition == 0)
+            {
+                return true;
+            }
+            if (!execute(ast->body(id)) || !step())
+            {
+                return false;
+            }
+        }
+    case NodeKind::PROGRAM:
+    case NodeKind::BLOCK:
+        for (NodeId stmt : ast->statements(id))
+        {
+            if (!execute(stmt))
+            {
+                return false;
+            }
+        }
+        return true;
+    default:
+        // Выражение на месте оператора: только вычисляется
+        Value value;
+        return evaluate(id, value);
+    }
+}
+
+bool ProgramEvaluator::print(NodeId expression)
+{
+    Value value;
+    if (!evaluate(expression, value))
+    {
+        return false;
+    }
+
+    // Способ печати выбирается по типу выражения, как в генераторе
+    bool asString = ast->kind(expression) == NodeKind::STRING_LITERAL ||
+                    (ast->kind(expression) == NodeKind::IDENTIFIER &&
+                     variable(expression).type == VarType::STRING);
+    if (asString)
+    {
+        if (value.kind != Value::Kind::STRING)
+        {
+            return fail("number printed as a string");
+        }
+        std::string text = ast->stringValue(value.literal);
+        std::string bytes;
+        if (!decodeStringLiteral(text.substr(1, text.size() - 2), bytes))
+        {
+            return fail("unsupported escape sequence in " + text);
+        }
+        result += bytes;
+    }
+    else
+    {
+        if (value.kind != Value::Kind::INT)
+        {
+            return fail("string address printed as a number");
+        }
+        result += std::to_string(value.number);
+    }
+    result += '\n';
+
+    if (result.size() > outputBudget)
+    {
+        return fail("output exceeds " + std::to_string(outputBudget) + " bytes");
+    }
+    return true;
+}
+
+bool ProgramEvaluator::evaluateInt(NodeId id, int32_t &number)
+{
+    Value value;
+    if (!evaluate(id, value))
+    {
+        return false;
+    }
+    if (value.kind != Value::Kind::INT)
+    {
+        return fail("string address used as a number");
+    }
+    number = value.number;
+    return true;
+}
+
+bool ProgramEvaluator::evaluate(NodeId id, Value &value)
+{
+    if (!step())
+    {
+        return false;
+    }
+    switch (ast->kind(id))
+    {
+    case NodeKind::INT_LITERAL:
+        value.kind = Value::Kind::INT;
+        value.number = ast->intValue(id);
+        return true;
+    case NodeKind::STRING_LITERAL:
+        value.kind = Value::Kind::STRING;
+        value.literal = id;
+        return true;
+    case NodeKind::IDENTIFIER:
+    {
+        const Variable &var = variable(id);
+        if (!var.declared)
+        {
+            return fail("undeclared variable " + ast->name(id));
+        }
+        if (var.value.kind == Value::Kind::UNSET)
+        {
+            return fail("variable " + ast->name(id) + " read before assignment");
+        }
+        value = var.value;
+        return true;
+    }
+    case NodeKind::UNARY_OP:
+    {
+        int32_t operand;
+        if (!evaluateInt(ast->operand(id), operand))
+        {
+            return false;
+        }
+        value.kind = Value::Kind::INT;
+        value.number = operand == 0;
+        return true;
+    }
+    case NodeKind::BINARY_OP:
+    {
+        int32_t a;
+        int32_t b;
+        if (!evaluateInt(ast->left(id), a) || !evaluateInt(ast->right(id), b))
+        {
+            return false;
+        }
+        // Сложение, вычитание и умножение - по модулю 2^32, как add/sub/mul
+        uint32_t ua = static_cast<uint32_t>(a);
+        uint32_t ub = static_cast<uint32_t>(b);
+        int32_t r = 0;
+        switch (ast->binOp(id))
+        {
+        case BinOpType::PLUS:
+            r = static_cast<int32_t>(ua + ub);
+            break;
+        case BinOpType::MINUS:
+            r = static_cast<int32_t>(ua - ub);
+            break;
+        case BinOpType::MUL:
+            r = static_cast<int32_t>(ua * ub);
+            break;
+        case BinOpType::DIV:
+            // div в RISC-V не вызывает исключений
+            if (b == 0)
+            {
+                r = -1;
+            }
+            else if (a == INT32_MIN && b == -1)
+            {
+                r = INT32_MIN;
+            }
+            else
+            {
+                r = a / b;
+            }
+            break;
+        case BinOpType::EQ:
+            r = a == b;
+            break;
+        case BinOpType::NEQ:
+            r = a != b;
+            break;
+        case BinOpType::LT:
+            r = a < b;
+            break;
+        case BinOpType::LE:
+            r = a <= b;
+            break;
+        case BinOpType::GT:
+            r = a > b;
+            break;
+        case BinOpType::GE:
+            r = a >= b;
+            break;
+        case BinOpType::AND:
+            r = a & b;
+            break;
+        case BinOpType::OR:
+            r = a | b;
+            break;
+        }
+        value.kind = Value::Kind::INT;
+        value.number = r;
+        return true;
+    }
+    default:
+        return fail("statement used as an expression");
+    }
+}
@@ -0,0 +1,79 @@
+#ifndef PRECOMPUTE_HPP
+#define PRECOMPUTE_HPP
+
+#include "ast.hpp"
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Бюджет по умолчанию: шаги - вычисленные узлы AST, вывод - байты
+const long PRECOMPUTE_DEFAULT_STEPS = 10000000;
+const size_t PRECOMPUTE_OUTPUT_LIMIT = 1 << 20;
+
+// Выполнение всей программы при компиляции. Ввода у программ нет, поэтому
+// завершившаяся программа заменяется своим выводом. Семантика та же, что
+// у сгенерированного кода на RV32: арифметика по модулю 2^32, деление на 0
+// дает -1, INT_MIN / -1 - INT_MIN, and и or - побитовые. Отказ (программа
+// компилируется как обычно): чтение переменной до присваивания, адрес строки
+// в арифметике или печати числа, выход за бюджет шагов или вывода.
+class ProgramEvaluator
+{
+private:
+    // Значение: число или строковый литерал (его адрес в сгенерированном коде)
+    struct Value
+    {
+        enum class Kind : uint8_t
+        {
+            UNSET,
+            INT,
+            STRING
+        };
+        Kind kind = Kind::UNSET;
+        int32_t number = 0;
+        NodeId literal = NO_NODE;
+    };
+    // Переменная по номеру имени в AST
+    struct Variable
+    {
+        bool known = false; // тип найден в объявлениях
+        bool declared = false;
+        VarType type = VarType::INT;
+        Value value;
+    };
+
+    const Ast *ast;
+    const std::unordered_map<std::string, VarType> &types; // последнее объявление
+    long stepBudget;
+    size_t outputBudget;
+    long stepCount;
+    std::vector<Variable> variables;
+    std::string result;
+    std::string failure;
+
+    Variable &variable(NodeId id);
+    bool fail(const std::string &reason);
+    bool step();
+    bool execute(NodeId id);
+    bool evaluate(NodeId id, Value &value);
+    bool evaluateInt(NodeId id, int32_t &number);
+    bool print(NodeId expression);
+
+public:
+    ProgramEvaluator(const Ast &tree, const std::unordered_map<std::string, VarType> &variableTypes,
+                     long steps, size_t outputBytes)
+        : ast(&tree), types(variableTypes), stepBudget(steps), outputBudget(outputBytes),
+          stepCount(0)
+    {
+    }
+
+    // true - программа завершилась в пределах бюджета
+    bool run();
+
+    const std::string &output() const { return result; }
+    // Причина отказа, если run() вернул false
+    const std::string &reason() const { return failure; }
+    long steps() const { return stepCount; }
+};
+
+#endif // PRECOMPUTE_HPP
@@ -0,0 +1,237 @@
+#include "runtime.hpp"
+#include <cctype>
+
+void emitRuntimeText(std::ostream &out)
+{
+    out << "\n# Buffered output runtime\n";
+
+    // Печать числа: цифры пишутся справа налево в __rt_num, деление на 10
+    // заменено умножением на обратное (mulhu с 0xCCCCCCCD и сдвиг на 3)
+    out << "__rt_print_int:\n";
+    out << "    la t0, __rt_len\n";
+    out << "    lw t1, 0(t0)\n";
+    out << "    li t2, " << RUNTIME_BUFFER_SIZE - 12 << "   # room for sign, 10 digits, newline\n";
+    out << "    bge t2, t1, __rt_print_int_room\n";
+    out << "    mv t1, a0\n";
+    out << "    jal t2, __rt_flush\n";
+    out << "    mv a0, t1\n";
+    out << "__rt_print_int_room:\n";
+    out << "    mv t1, a0         # keep sign\n";
+    out << "    bgez a0, __rt_print_int_abs\n";
+    out << "    neg a0, a0        # magnitude, unsigned for INT_MIN\n";
+    out << "__rt_print_int_abs:\n";
+    out << "    la a1, __rt_num_end\n";
+    out << "    li t2, 10\n";
+    out << "    addi a1, a1, -1\n";
+    out << "    sb t2, 0(a1)      # newline\n";
+    out << "    li a2, -858993459 # 0xCCCCCCCD\n";
+    out << "__rt_print_int_digit:\n";
+    out << "    mulhu t0, a0, a2\n";
+    out << "    srli t0, t0, 3    # q = n / 10\n";
+    out << "    slli t2, t0, 2\n";
+    out << "    add t2, t2, t0\n";
+    out << "    slli t2, t2, 1    # q * 10\n";
+    out << "    sub t2, a0, t2\n";
+    out << "    addi t2, t2, 48\n";
+    out << "    addi a1, a1, -1\n";
+    out << "    sb t2, 0(a1)\n";
+    out << "    mv a0, t0\n";
+    out << "    bnez a0, __rt_print_int_digit\n";
+    out << "    bgez t1, __rt_print_int_copy\n";
+    out << "    li t2, 45\n";
+    out << "    addi a1, a1, -1\n";
+    out << "    sb t2, 0(a1)      # minus sign\n";
+    out << "__rt_print_int_copy:\n";
+    out << "    la t0, __rt_len\n";
+    out << "    lw t1, 0(t0)\n";
+    out << "    la a2, __rt_buf\n";
+    out << "    add a2, a2, t1\n";
+    out << "    la a0, __rt_num_end\n";
+    out << "__rt_print_int_byte:\n";
+    out << "    lbu t2, 0(a1)\n";
+    out << "    sb t2, 0(a2)\n";
+    out << "    addi a1, a1, 1\n";
+    out << "    addi a2, a2, 1\n";
+    out << "    bltu a1, a0, __rt_print_int_byte\n";
+    out << "    la a0, __rt_buf\n";
+    out << "    sub t1, a2, a0\n";
+    out << "    sw t1, 0(t0)\n";
+    out << "    ret\n";
+
+    // Печать строки с длиной; строка длиннее буфера пишется напрямую
+    out << "__rt_print_str:\n";
+    out << "    li a2, 0\n";
+    out << "    beqz a0, __rt_print_str_room   # unassigned string prints as empty\n";
+    out << "    lw a2, 0(a0)      # length\n";
+    out << "    addi a1, a0, 4    # bytes\n";
+    out << "__rt_print_str_room:\n";
+    out << "    la t0, __rt_len\n";
+    out << "    lw t1, 0(t0)\n";
+    out << "    li t2, " << RUNTIME_BUFFER_SIZE - 1 << "\n";
+    out << "    sub t2, t2, a2\n";
+    out << "    bge t2, t1, __rt_print_str_copy\n";
+    out << "    la t0, __rt_save\n";
+    out << "    sw a1, 0(t0)\n";
+    out << "    sw a2, 4(t0)\n";
+    out << "    jal t2, __rt_flush\n";
+    out << "    la t0, __rt_save\n";
+    out << "    lw a1, 0(t0)\n";
+    out << "    lw a2, 4(t0)\n";
+    out << "    li t1, 0\n";
+    out << "    li t2, " << RUNTIME_BUFFER_SIZE - 1 << "\n";
+    out << "    bge t2, a2, __rt_print_str_copy\n";
+    out << "    jal t2, __rt_write\n";
+    out << "    li a2, 0\n";
+    out << "__rt_print_str_copy:\n";
+    out << "    la t0, __rt_buf\n";
+    out << "    add t0, t0, t1\n";
+    out << "    add t1, t1, a2\n";
+    out << "    beqz a2, __rt_print_str_done\n";
+    out << "__rt_print_str_byte:\n";
+    out << "    lbu a0, 0(a1)\n";
+    out << "    sb a0, 0(t0)\n";
+    out << "    addi a1, a1, 1\n";
+    out << "    addi t0, t0, 1\n";
+    out << "    addi a2, a2, -1\n";
+    out << "    bnez a2, __rt_print_str_byte\n";
+    out << "__rt_print_str_done:\n";
+    out << "    li a0, 10\n";
+    out << "    sb a0, 0(t0)      # newline\n";
+    out << "    addi t1, t1, 1\n";
+    out << "    la t0, __rt_len\n";
+    out << "    sw t1, 0(t0)\n";
+    out << "    ret\n";
+
+    // Сброс буфера (возврат через t2)
+    out << "__rt_flush:\n";
+    out << "    la t0, __rt_len\n";
+    out << "    la a1, __rt_buf\n";
+    out << "    lw a2, 0(t0)\n";
+    out << "    sw zero, 0(t0)\n";
+
+    // write(1, a1, a2) до полной записи (возврат через t2)
+    out << "__rt_write:\n";
+    out << "    blez a2, __rt_write_done\n";
+    out << "    li a0, 1      # stdout\n";
+    out << "    li a7, 64     # write system call\n";
+    out << "    ecall\n";
+    out << "    blez a0, __rt_write_done   # error: drop the rest\n";
+    out << "    add a1, a1, a0\n";
+    out << "    sub a2, a2, a0\n";
+    out << "    j __rt_write\n";
+    out << "__rt_write_done:\n";
+    out << "    jr t2\n";
+}
+
+void emitRuntimeData(std::ostream &out)
+{
+    out << "\n.bss\n";
+    out << ".align 2\n";
+    out << "__rt_len: .space 4\n";
+    out << "__rt_save: .space 8\n";
+    out << "__rt_num: .space 12\n";
+    out << "__rt_num_end:\n";
+    out << "__rt_buf: .space " << RUNTIME_BUFFER_SIZE << "\n";
+}
+
+int decodedStringLength(const std::string &str)
+{
+    int length = 0;
+    for (size_t i = 0; i < str.size(); ++i, ++length)
+    {
+        if (str[i] != '\\' || i + 1 == str.size())
+        {
+            continue;
+        }
+        ++i;
+        if (str[i] >= '0' && str[i] <= '7')
+        {
+            // \NNN - до трех восьмеричных цифр
+            size_t end = i + 1;
+            while (end < str.size() && end < i + 3 && str[end] >= '0' && str[end] <= '7')
+            {
+                ++end;
+            }
+            i = end - 1;
+        }
+        else if (str[i] == 'x')
+        {
+            while (i + 1 < str.size() && std::isxdigit(static_cast<unsigned char>(str[i + 1])))
+            {
+                ++i;
+            }
+        }
+    }
+    return length;
+}
+
+bool decodeStringLiteral(const std::string &str, std::string &bytes)
+{
+    bytes.clear();
+    for (size_t i = 0; i < str.size(); ++i)
+    {
+        if (str[i] != '\\' || i + 1 == str.size())
+        {
+            bytes += str[i];
+            continue;
+        }
+        char c = str[++i];
+        if (c >= '0' && c <= '7')
+        {
+            // \NNN - до трех восьмеричных цифр, в байт попадают младшие 8 бит
+            int value = 0;
+            size_t end = i;
+            while (end < str.size() && end < i + 3 && str[end] >= '0' && str[end] <= '7')
+            {
+                value = value * 8 + (str[end++] - '0');
+            }
+            bytes += static_cast<char>(value);
+            i = end - 1;
+            continue;
+        }
+        switch (c)
+        {
+        case 'x':
+        {
+            // \x - все следующие шестнадцатеричные цифры
+            unsigned value = 0;
+            size_t start = i;
+            while (i + 1 < str.size() && std::isxdigit(static_cast<unsigned char>(str[i + 1])))
+            {
+                char d = str[++i];
+                value = value * 16 + (std::isdigit(static_cast<unsigned char>(d))
+                                          ? d - '0'
+                                          : std::tolower(static_cast<unsigned char>(d)) - 'a' + 10);
+            }
+            if (i == start)
+            {
+                return false;
+            }
+            bytes += static_cast<char>(value);
+            break;
+        }
+        case 'b':
+            bytes += '\b';
+            break;
+        case 'f':
+            bytes += '\f';
+            break;
+        case 'n':
+            bytes += '\n';
+            break;
+        case 'r':
+            bytes += '\r';
+            break;
+        case 't':
+            bytes += '\t';
+            break;
+        case '\\':
+        case '"':
+            bytes += c;
+            break;
+        default:
+            return false;
+        }
+    }
+    return true;
+}
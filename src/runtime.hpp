@@ -0,0 +1,27 @@
+#ifndef RUNTIME_HPP
+#define RUNTIME_HPP
+
+#include <ostream>
+#include <string>
+
+// Размер буфера вывода: системный вызов write выполняется, когда буфер
+// заполнен, и один раз при выходе из программы
+const int RUNTIME_BUFFER_SIZE = 4096;
+
+// Подпрограммы времени выполнения (вызываются через call):
+//   __rt_print_int - a0 = число, печатает его и перевод строки
+//   __rt_print_str - a0 = адрес строки с длиной (.word длина, затем байты)
+//   __rt_flush     - вызывается через jal t2, сбрасывает буфер
+// Портят только a0-a2, a7, t0-t2 и ra; регистры s*, t3-t6, a3-a6 сохраняются.
+void emitRuntimeText(std::ostream &out);
+void emitRuntimeData(std::ostream &out);
+
+// Длина строкового литерала после разбора escape-последовательностей
+// (так же, как их разбирает ассемблер в .ascii)
+int decodedStringLength(const std::string &str);
+
+// Байты строкового литерала (без кавычек), как их выдаст .ascii;
+// false - escape-последовательность, которую ассемблер не принимает
+bool decodeStringLiteral(const std::string &str, std::string &bytes);
+
+#endif // RUNTIME_HPP
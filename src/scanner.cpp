@@ -0,0 +1,259 @@
+#include "scanner.hpp"
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+const char *tokenName(TokenKind kind)
+{
+    static const char *const names[] = {
+        "end of file", "INTEGER", "STRING", "IDENTIFIER", "INT_TYPE", "STRING_TYPE",
+        "IF", "ELSE", "WHILE", "PRINT", "NOT", "AND", "OR", "EQ", "NEQ", "LE", "GE",
+        "LT", "GT", "PLUS", "MINUS", "MUL", "DIV", "ASSIGN", "SEMI", "LBRACE", "RBRACE",
+        "LPAREN", "RPAREN"};
+    return names[static_cast<int>(kind)];
+}
+
+static bool isLetter(char c)
+{
+    return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || c == '_';
+}
+
+static bool isDigit(char c)
+{
+    return c >= '0' && c <= '9';
+}
+
+// Ключевое слово или IDENTIFIER: сначала отбор по длине
+static TokenKind keyword(const char *text, size_t length)
+{
+    switch (length)
+    {
+    case 2:
+        if (memcmp(text, "if", 2) == 0)
+        {
+            return TokenKind::IF;
+        }
+        if (memcmp(text, "or", 2) == 0)
+        {
+            return TokenKind::OR;
+        }
+        break;
+    case 3:
+        if (memcmp(text, "int", 3) == 0)
+        {
+            return TokenKind::INT_TYPE;
+        }
+        if (memcmp(text, "not", 3) == 0)
+        {
+            return TokenKind::NOT;
+        }
+        if (memcmp(text, "and", 3) == 0)
+        {
+            return TokenKind::AND;
+        }
+        break;
+    case 4:
+        if (memcmp(text, "else", 4) == 0)
+        {
+            return TokenKind::ELSE;
+        }
+        break;
+    case 5:
+        if (memcmp(text, "while", 5) == 0)
+        {
+            return TokenKind::WHILE;
+        }
+        if (memcmp(text, "print", 5) == 0)
+        {
+            return TokenKind::PRINT;
+        }
+        break;
+    case 6:
+        if (memcmp(text, "string", 6) == 0)
+        {
+            return TokenKind::STRING_TYPE;
+        }
+        break;
+    default:
+        break;
+    }
+    return TokenKind::IDENTIFIER;
+}
+
+void Scanner::skipSpaceAndComments()
+{
+    while (pos < source.size())
+    {
+        char c = source[pos];
+        if (c == ' ' || c == '\t' || c == '\r')
+        {
+            ++pos;
+        }
+        else if (c == '\n')
+        {
+            ++line;
+            ++pos;
+        }
+        else if (c == '/' && pos + 1 < source.size() && source[pos + 1] == '/')
+        {
+            // До конца строки; перевод строки остается пробельным символом
+            while (pos < source.size() && source[pos] != '\n')
+            {
+                ++pos;
+            }
+        }
+        else if (c == '/' && pos + 1 < source.size() && source[pos + 1] == '*')
+        {
+            // Незакрытый комментарий - это DIV и MUL, как в lexer.l
+            size_t end = source.find("*/", pos + 2);
+            if (end == std::string::npos)
+            {
+                return;
+            }
+            for (; pos < end + 2; ++pos)
+            {
+                line += source[pos] == '\n';
+            }
+        }
+        else
+        {
+            return;
+        }
+    }
+}
+
+Token Scanner::makeToken(TokenKind kind, size_t start)
+{
+    ++tokenCount;
+    return {kind, line, static_cast<uint32_t>(start), static_cast<uint32_t>(pos - start), 0};
+}
+
+Token Scanner::next()
+{
+    for (;;)
+    {
+        skipSpaceAndComments();
+        size_t start = pos;
+        if (pos >= source.size())
+        {
+            return {TokenKind::END, line, static_cast<uint32_t>(pos), 0, 0};
+        }
+
+        char c = source[pos];
+        if (isDigit(c))
+        {
+            while (pos < source.size() && isDigit(source[pos]))
+            {
+                ++pos;
+            }
+            Token token = makeToken(TokenKind::INTEGER, start);
+            token.value = atoi(source.c_str() + start); // как atoi(yytext) в lexer.l
+            return token;
+        }
+        if (isLetter(c))
+        {
+            while (pos < source.size() && (isLetter(source[pos]) || isDigit(source[pos])))
+            {
+                ++pos;
+            }
+            return makeToken(keyword(source.data() + start, pos - start), start);
+        }
+        if (c == '"')
+        {
+            // Строка может занимать несколько строк; после \ - любой символ,
+            // кроме перевода строки. Токен остается с кавычками
+            size_t end = pos + 1;
+            uint32_t newlines = 0;
+            bool closed = false;
+            while (end < source.size())
+            {
+                if (source[end] == '"')
+                {
+                    closed = true;
+                    break;
+                }
+                if (source[end] == '\\')
+                {
+                    if (end + 1 >= source.size() || source[end + 1] == '\n')
+                    {
+                        break;
+                    }
+                    end += 2;
+                    continue;
+                }
+                newlines += source[end] == '\n';
+                ++end;
+            }
+            if (closed)
+            {
+                pos = end + 1;
+                line += newlines;
+                return makeToken(TokenKind::STRING, start);
+            }
+        }
+
+        // Операторы: сначала двухсимвольные
+        char d = pos + 1 < source.size() ? source[pos + 1] : '\0';
+        TokenKind kind = TokenKind::END;
+        size_t length = 1;
+        switch (c)
+        {
+        case '=':
+            kind = d == '=' ? TokenKind::EQ : TokenKind::ASSIGN;
+            length = d == '=' ? 2 : 1;
+            break;
+        case '!':
+            if (d == '=')
+            {
+                kind = TokenKind::NEQ;
+                length = 2;
+            }
+            break;
+        case '<':
+            kind = d == '=' ? TokenKind::LE : TokenKind::LT;
+            length = d == '=' ? 2 : 1;
+            break;
+        case '>':
+            kind = d == '=' ? TokenKind::GE : TokenKind::GT;
+            length = d == '=' ? 2 : 1;
+            break;
+        case '+':
+            kind = TokenKind::PLUS;
+            break;
+        case '-':
+            kind = TokenKind::MINUS;
+            break;
+        case '*':
+            kind = TokenKind::MUL;
+            break;
+        case '/':
+            kind = TokenKind::DIV;
+            break;
+        case ';':
+            kind = TokenKind::SEMI;
+            break;
+        case '{':
+            kind = TokenKind::LBRACE;
+            break;
+        case '}':
+            kind = TokenKind::RBRACE;
+            break;
+        case '(':
+            kind = TokenKind::LPAREN;
+            break;
+        case ')':
+            kind = TokenKind::RPAREN;
+            break;
+        default:
+            break;
+        }
+        if (kind != TokenKind::END)
+        {
+            pos += length;
+            return makeToken(kind, start);
+        }
+
+        printf("Unexpected character: %.1s\n", source.c_str() + pos);
+        ++pos;
+    }
+}
@@ -0,0 +1,76 @@
+#ifndef SCANNER_HPP
+#define SCANNER_HPP
+
+#include <cstdint>
+#include <string>
+
+// Токены - те же, что в parser.y
+enum class TokenKind : uint8_t
+{
+    END, // конец файла
+    INTEGER,
+    STRING,
+    IDENTIFIER,
+    INT_TYPE,
+    STRING_TYPE,
+    IF,
+    ELSE,
+    WHILE,
+    PRINT,
+    NOT,
+    AND,
+    OR,
+    EQ,
+    NEQ,
+    LE,
+    GE,
+    LT,
+    GT,
+    PLUS,
+    MINUS,
+    MUL,
+    DIV,
+    ASSIGN,
+    SEMI,
+    LBRACE,
+    RBRACE,
+    LPAREN,
+    RPAREN
+};
+
+// Имя токена в сообщениях об ошибках (как у Bison)
+const char *tokenName(TokenKind kind);
+
+struct Token
+{
+    TokenKind kind;
+    uint32_t line;
+    uint32_t start;  // смещение текста токена во входном буфере
+    uint32_t length;
+    int value;       // INTEGER
+};
+
+// Сканер, написанный вручную: распознает то же, что lexer.l, за один
+// проход по буферу со всем входным файлом, без копирования текста
+// токенов. Неизвестный символ печатается и пропускается, как в lexer.l.
+class Scanner
+{
+private:
+    const std::string &source;
+    size_t pos;
+    uint32_t line;
+    size_t tokenCount;
+
+    void skipSpaceAndComments();
+    Token makeToken(TokenKind kind, size_t start);
+
+public:
+    explicit Scanner(const std::string &input) : source(input), pos(0), line(1), tokenCount(0) {}
+
+    Token next();
+
+    std::string text(const Token &token) const { return source.substr(token.start, token.length); }
+    size_t tokens() const { return tokenCount; }
+};
+
+#endif // SCANNER_HPP
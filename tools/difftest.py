@@ -0,0 +1,248 @@
+#!/usr/bin/env python3
+"""Дифференциальная проверка компилятора на случайных программах.
+
+Генерирует программы (переменные, арифметика, сравнения, and/or/not,
+вложенные if и ограниченные циклы while, печать чисел и строк), вычисляет
+их вывод эталонным интерпретатором с семантикой RV32 и сравнивает с
+выводом скомпилированной программы в tools/rvsim.py.
+
+Использование:
+  tools/difftest.py [--count N] [--seed S] [--vars N] [--statements N]
+                    [--precompute] [--keep DIR] [-- флаги компилятора...]
+
+--precompute дополнительно собирает каждую программу с --precompute и
+требует того же вывода. Программы с расхождениями сохраняются в --keep.
+Код возврата - 1, если нашлось расхождение.
+"""
+import argparse
+import os
+import random
+import subprocess
+import sys
+import tempfile
+
+sys.path.insert(0, os.path.dirname(os.path.abspath(__file__)))
+import rvsim  # noqa: E402
+
+OPERATORS = ['+', '-', '*', '/', '==', '!=', '<', '<=', '>', '>=', 'and', 'or', '+', '-', '+']
+STRINGS = ['hello', 'a b c', 'tab\\there', 'say \\"hi\\"', '']
+
+
+def to_s32(value):
+    value &= 0xffffffff
+    return value - (1 << 32) if value & 0x80000000 else value
+
+
+class Generator:
+    """Случайная программа в виде кортежей; счетчики циклов не меняются в теле."""
+
+    def __init__(self, rnd, variables, depth):
+        self.rnd = rnd
+        self.variables = ['v%d' % i for i in range(variables)]
+        self.depth = depth
+        self.loops = 0
+        self.locked = set()
+
+    def expression(self, level=0):
+        rnd = self.rnd
+        if level > 2 or rnd.random() < 0.3:
+            if rnd.random() < 0.5:
+                return ('num', rnd.randint(-5, 20))
+            return ('var', rnd.choice(self.variables))
+        if rnd.random() < 0.1:
+            return ('not', self.expression(level + 1))
+        return ('bin', rnd.choice(OPERATORS), self.expression(level + 1), self.expression(level + 1))
+
+    def statements(self, count, level):
+        return [self.statement(level) for _ in range(count)]
+
+    def statement(self, level):
+        rnd = self.rnd
+        kind = rnd.random()
+        free = [v for v in self.variables if v not in self.locked]
+        if level < self.depth and kind < 0.15:
+            then = self.statements(rnd.randint(0, 3), level + 1)
+            other = self.statements(rnd.randint(0, 3), level + 1) if rnd.random() < 0.6 else None
+            return ('if', self.expression(), then, other)
+        if level < self.depth and kind < 0.25:
+            counter = 'c%d' % self.loops
+            self.loops += 1
+            self.locked.add(counter)
+            body = self.statements(rnd.randint(1, 3), level + 1)
+            self.locked.discard(counter)
+            return ('loop', counter, rnd.randint(0, 6), body)
+        if kind < 0.3:
+            if rnd.random() < 0.5:
+                return ('assign_string', rnd.choice(STRINGS))
+            return ('print_string',)
+        if kind < 0.7 and free:
+            return ('assign', rnd.choice(free), self.expression())
+        return ('print', self.expression())
+
+
+def evaluate(node, env):
+    kind = node[0]
+    if kind == 'num':
+        return node[1]
+    if kind == 'var':
+        return env[node[1]]
+    if kind == 'not':
+        return int(evaluate(node[1], env) == 0)
+    op, a, b = node[1], evaluate(node[2], env), evaluate(node[3], env)
+    if op == '+':
+        return to_s32(a + b)
+    if op == '-':
+        return to_s32(a - b)
+    if op == '*':
+        return to_s32(a * b)
+    if op == '/':
+        # Как div в RV32: деление на 0 дает -1, INT_MIN / -1 - INT_MIN
+        if b == 0:
+            return -1
+        if a == -2 ** 31 and b == -1:
+            return a
+        quotient = abs(a) // abs(b)
+        return to_s32(quotient if (a < 0) == (b < 0) else -quotient)
+    if op == 'and':
+        return a & b
+    if op == 'or':
+        return a | b
+    return int({'==': a == b, '!=': a != b, '<': a < b,
+                '<=': a <= b, '>': a > b, '>=': a >= b}[op])
+
+
+def execute(statements, env, out):
+    for s in statements:
+        kind = s[0]
+        if kind == 'assign':
+            env[s[1]] = evaluate(s[2], env)
+        elif kind == 'print':
+            out.append(str(evaluate(s[1], env)))
+        elif kind == 'assign_string':
+            env['s'] = s[1]
+        elif kind == 'print_string':
+            out.append(env['s'].replace('\\t', '\t').replace('\\"', '"'))
+        elif kind == 'if':
+            if evaluate(s[1], env):
+                execute(s[2], env, out)
+            elif s[3]:
+                execute(s[3], env, out)
+        elif kind == 'loop':
+            env[s[1]] = 0
+            while env[s[1]] < s[2]:
+                execute(s[3], env, out)
+                env[s[1]] = to_s32(env[s[1]] + 1)
+
+
+def format_expression(node):
+    kind = node[0]
+    if kind == 'num':
+        return str(node[1]) if node[1] >= 0 else '(0 - %d)' % -node[1]
+    if kind == 'var':
+        return node[1]
+    if kind == 'not':
+        return 'not (%s)' % format_expression(node[1])
+    return '(%s %s %s)' % (format_expression(node[2]), node[1], format_expression(node[3]))
+
+
+def format_statements(statements, indent=0):
+    pad = '    ' * indent
+    lines = []
+    for s in statements:
+        kind = s[0]
+        if kind == 'assign':
+            lines.append(pad + '%s = %s;' % (s[1], format_expression(s[2])))
+        elif kind == 'print':
+            lines.append(pad + 'print %s;' % format_expression(s[1]))
+        elif kind == 'assign_string':
+            lines.append(pad + 's = "%s";' % s[1])
+        elif kind == 'print_string':
+            lines.append(pad + 'print s;')
+        elif kind == 'if':
+            lines.append(pad + 'if (%s) {' % format_expression(s[1]))
+            lines += format_statements(s[2], indent + 1)
+            if s[3] is not None:
+                lines.append(pad + '} else {')
+                lines += format_statements(s[3], indent + 1)
+            lines.append(pad + '}')
+        elif kind == 'loop':
+            lines.append(pad + '%s = 0;' % s[1])
+            lines.append(pad + 'while (%s < %d) {' % (s[1], s[2]))
+            lines += format_statements(s[3], indent + 1)
+            lines.append(pad + '    %s = %s + 1;' % (s[1], s[1]))
+            lines.append(pad + '}')
+    return lines
+
+
+def make_program(seed, variables, statements):
+    """Текст программы и ее ожидаемый вывод."""
+    rnd = random.Random(seed)
+    generator = Generator(rnd, variables or rnd.randint(1, 5), 3)
+    body = generator.statements(statements or rnd.randint(3, 12), 0)
+    names = generator.variables + ['c%d' % i for i in range(generator.loops)]
+    program = [('assign', v, ('num', rnd.randint(0, 9))) for v in names]
+    program += [('assign_string', rnd.choice(STRINGS))] + body
+    text = '\n'.join(['int %s;' % v for v in names] + ['string s;'] + format_statements(program))
+    out = []
+    execute(program, {}, out)
+    return text + '\n', ''.join(line + '\n' for line in out)
+
+
+def compile_and_run(compiler, flags, source, workdir):
+    assembly = os.path.join(workdir, 'program.s')
+    result = subprocess.run([compiler, *flags, source, assembly], capture_output=True, text=True)
+    if result.returncode != 0:
+        return 'compiler error: ' + (result.stdout + result.stderr)[-500:]
+    try:
+        out, _, _, _ = rvsim.run(assembly, 5_000_000)
+    except rvsim.SimulationError as error:
+        return 'simulation error: %s' % error
+    return out.decode(errors='replace')
+
+
+def main():
+    parser = argparse.ArgumentParser(description='Differential test against a reference interpreter')
+    parser.add_argument('--count', type=int, default=100)
+    parser.add_argument('--seed', type=int, default=0, help='seed of the first program')
+    parser.add_argument('--vars', type=int, default=0, help='variables per program (default 1-5)')
+    parser.add_argument('--statements', type=int, default=0, help='top-level statements (default 3-12)')
+    parser.add_argument('--precompute', action='store_true', help='also compare a --precompute build')
+    parser.add_argument('--keep', help='directory for programs that fail')
+    parser.add_argument('--compiler', default=os.environ.get('COMPILER', 'build/bin/compiler'))
+    parser.add_argument('flags', nargs='*', help='compiler flags, after --')
+    args = parser.parse_args()
+
+    builds = [('default', args.flags)]
+    if args.precompute:
+        builds.append(('--precompute', args.flags + ['--precompute']))
+
+    failures = 0
+    with tempfile.TemporaryDirectory() as workdir:
+        source = os.path.join(workdir, 'program.prog')
+        for seed in range(args.seed, args.seed + args.count):
+            text, expected = make_program(seed, args.vars, args.statements)
+            with open(source, 'w') as f:
+                f.write(text)
+            for name, flags in builds:
+                actual = compile_and_run(args.compiler, flags, source, workdir)
+                if actual == expected:
+                    continue
+                failures += 1
+                print('seed %d (%s): output differs from the reference' % (seed, name))
+                if args.keep:
+                    os.makedirs(args.keep, exist_ok=True)
+                    base = os.path.join(args.keep, 'seed%d' % seed)
+                    with open(base + '.prog', 'w') as f:
+                        f.write(text)
+                    with open(base + '.expected', 'w') as f:
+                        f.write(expected)
+                    with open(base + '.actual', 'w') as f:
+                        f.write(actual)
+                break
+
+    print('%d programs, %d failures' % (args.count, failures))
+    return 1 if failures else 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
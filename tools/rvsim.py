@@ -0,0 +1,321 @@
+#!/usr/bin/env python3
+"""Простой симулятор RV32IM на уровне ассемблера.
+
+Исполняет .s, который выдает компилятор, без ассемблера и эмулятора:
+поддерживает директивы и инструкции, которые генерирует codegen и
+runtime, и системные вызовы write (64) и exit (93), а также печать числа
+(1, значение в a1) и символа (11, код в a0), которые выдает печать без
+runtime.
+
+Использование: tools/rvsim.py файл.s [--max-steps N]
+Вывод программы в fd 1 и fd 2 идет в stdout и stderr, код возврата -
+код выхода программы.
+"""
+import re
+import struct
+import sys
+
+ABI_NAMES = ['zero', 'ra', 'sp', 'gp', 'tp', 't0', 't1', 't2',
+             's0', 's1', 'a0', 'a1', 'a2', 'a3', 'a4', 'a5',
+             'a6', 'a7', 's2', 's3', 's4', 's5', 's6', 's7',
+             's8', 's9', 's10', 's11', 't3', 't4', 't5', 't6']
+REGISTERS = {name: i for i, name in enumerate(ABI_NAMES)}
+REGISTERS.update({'x%d' % i: i for i in range(32)})
+REGISTERS['fp'] = 8
+
+DATA_BASE = 0x10000
+MEMORY_SIZE = 1 << 20
+STACK_BASE = 0x7f000000
+STACK_SIZE = 1 << 20
+
+ESCAPES = {'n': 10, 't': 9, 'r': 13, '\\': 92, '"': 34, '0': 0, 'b': 8, 'f': 12}
+
+
+class SimulationError(Exception):
+    pass
+
+
+def to_s32(value):
+    value &= 0xffffffff
+    return value - (1 << 32) if value & 0x80000000 else value
+
+
+def decode_string(text):
+    """Раскрывает escape-последовательности так же, как .ascii в ассемблере."""
+    out = bytearray()
+    i = 0
+    while i < len(text):
+        if text[i] != '\\' or i + 1 == len(text):
+            out += text[i].encode()
+            i += 1
+            continue
+        c = text[i + 1]
+        if c in '01234567':
+            j = i + 1
+            while j < len(text) and j < i + 4 and text[j] in '01234567':
+                j += 1
+            out.append(int(text[i + 1:j], 8) & 255)
+            i = j
+        elif c == 'x':
+            j = i + 2
+            while j < len(text) and text[j] in '0123456789abcdefABCDEF':
+                j += 1
+            out.append(int(text[i + 2:j], 16) & 255)
+            i = j
+        else:
+            out.append(ESCAPES.get(c, ord(c)))
+            i += 2
+    return bytes(out)
+
+
+def split_operands(text):
+    """Делит операнды по запятым вне строковых литералов."""
+    operands, current, quoted = [], '', False
+    for i, c in enumerate(text):
+        if c == '"' and (i == 0 or text[i - 1] != '\\'):
+            quoted = not quoted
+        if c == ',' and not quoted:
+            operands.append(current.strip())
+            current = ''
+        else:
+            current += c
+    if current.strip():
+        operands.append(current.strip())
+    return operands
+
+
+def strip_comment(line):
+    quoted = False
+    for i, c in enumerate(line):
+        if c == '"' and (i == 0 or line[i - 1] != '\\'):
+            quoted = not quoted
+        if c == '#' and not quoted:
+            return line[:i]
+    return line
+
+
+def load(path):
+    """Разбирает файл: возвращает память данных, список инструкций и метки."""
+    memory = bytearray(MEMORY_SIZE)
+    text, labels, fixups = [], {}, []
+    in_text = True
+    pointer = DATA_BASE
+    for raw in open(path):
+        line = strip_comment(raw).strip()
+        match = re.match(r'^([A-Za-z_.$][\w.$]*):\s*(.*)$', line)
+        while match:
+            labels[match.group(1)] = len(text) if in_text else pointer
+            line = match.group(2).strip()
+            match = re.match(r'^([A-Za-z_.$][\w.$]*):\s*(.*)$', line)
+        if not line:
+            continue
+        parts = line.split(None, 1)
+        op, rest = parts[0], parts[1] if len(parts) > 1 else ''
+        if op in ('.data', '.rodata', '.bss'):
+            in_text = False
+        elif op == '.text':
+            in_text = True
+        elif op in ('.globl', '.global', '.type', '.size'):
+            pass
+        elif op == '.align':
+            alignment = 1 << int(rest)
+            pointer = (pointer + alignment - 1) & ~(alignment - 1)
+        elif op == '.word':
+            for value in split_operands(rest):
+                try:
+                    struct.pack_into('<i', memory, pointer, to_s32(int(value, 0)))
+                except ValueError:
+                    fixups.append((pointer, value))
+                pointer += 4
+        elif op == '.byte':
+            for value in split_operands(rest):
+                memory[pointer] = int(value, 0) & 255
+                pointer += 1
+        elif op in ('.ascii', '.asciz', '.string'):
+            for value in split_operands(rest):
+                data = decode_string(value[1:-1]) + (b'' if op == '.ascii' else b'\0')
+                memory[pointer:pointer + len(data)] = data
+                pointer += len(data)
+        elif op in ('.space', '.zero'):
+            pointer += int(rest, 0)
+        elif op.startswith('.'):
+            raise SimulationError('unknown directive ' + op)
+        else:
+            text.append((op, split_operands(rest), raw.strip()))
+    for address, label in fixups:
+        struct.pack_into('<I', memory, address, labels[label])
+    return memory, text, labels
+
+
+BRANCHES = {
+    'beq': lambda x, y: x == y, 'bne': lambda x, y: x != y,
+    'blt': lambda x, y: x < y, 'bge': lambda x, y: x >= y,
+    'bltu': lambda x, y: x & 0xffffffff < y & 0xffffffff,
+    'bgeu': lambda x, y: x & 0xffffffff >= y & 0xffffffff,
+}
+BRANCHES_ZERO = {
+    'beqz': lambda x: x == 0, 'bnez': lambda x: x != 0,
+    'bltz': lambda x: x < 0, 'bgez': lambda x: x >= 0,
+    'blez': lambda x: x <= 0, 'bgtz': lambda x: x > 0,
+}
+
+
+def divide(x, y):
+    if y == 0:
+        return -1
+    if x == -2 ** 31 and y == -1:
+        return x
+    quotient = abs(x) // abs(y)
+    return quotient if (x < 0) == (y < 0) else -quotient
+
+
+def remainder(x, y):
+    if y == 0:
+        return x
+    if x == -2 ** 31 and y == -1:
+        return 0
+    return x - divide(x, y) * y
+
+
+ALU = {
+    'add': lambda x, y: x + y, 'sub': lambda x, y: x - y,
+    'mul': lambda x, y: x * y,
+    'mulh': lambda x, y: (x * y) >> 32,
+    'mulhu': lambda x, y: ((x & 0xffffffff) * (y & 0xffffffff)) >> 32,
+    'div': divide, 'rem': remainder,
+    'and': lambda x, y: x & y, 'or': lambda x, y: x | y, 'xor': lambda x, y: x ^ y,
+    'slt': lambda x, y: int(x < y),
+    'sltu': lambda x, y: int(x & 0xffffffff < y & 0xffffffff),
+    'sll': lambda x, y: x << (y & 31), 'srl': lambda x, y: (x & 0xffffffff) >> (y & 31),
+    'sra': lambda x, y: x >> (y & 31),
+}
+ALU_IMMEDIATE = {'addi': 'add', 'andi': 'and', 'ori': 'or', 'xori': 'xor', 'slti': 'slt',
+                 'sltiu': 'sltu', 'slli': 'sll', 'srli': 'srl', 'srai': 'sra'}
+LOADS = {'lw': (4, True), 'lh': (2, True), 'lhu': (2, False), 'lb': (1, True), 'lbu': (1, False)}
+STORES = {'sw': 4, 'sh': 2, 'sb': 1}
+
+
+def run(path, max_steps=50_000_000):
+    """Исполняет программу с _start. Возвращает (stdout, stderr, код выхода, шаги)."""
+    memory, text, labels = load(path)
+    stack = bytearray(STACK_SIZE)
+    regs = [0] * 32
+    regs[REGISTERS['sp']] = STACK_BASE + STACK_SIZE - 16
+    streams = {1: bytearray(), 2: bytearray()}
+
+    def locate(address):
+        address &= 0xffffffff
+        if STACK_BASE <= address < STACK_BASE + STACK_SIZE:
+            return stack, address - STACK_BASE
+        if address < MEMORY_SIZE:
+            return memory, address
+        raise SimulationError('bad address 0x%x' % address)
+
+    def reg(name):
+        return regs[REGISTERS[name]]
+
+    def write(name, value):
+        index = REGISTERS[name]
+        if index:
+            regs[index] = to_s32(value)
+
+    def immediate(operand):
+        return labels[operand] if operand in labels else int(operand, 0)
+
+    def address_of(operand):
+        match = re.match(r'^(-?\w*)\((\w+)\)$', operand)
+        offset = int(match.group(1), 0) if match.group(1) else 0
+        return reg(match.group(2)) + offset
+
+    pc = labels['_start']
+    steps = 0
+    while True:
+        if pc >= len(text):
+            raise SimulationError('fell off the end of .text')
+        steps += 1
+        if steps > max_steps:
+            raise SimulationError('step limit exceeded')
+        op, args, raw = text[pc]
+        pc += 1
+        if op == 'li':
+            write(args[0], immediate(args[1]))
+        elif op == 'la':
+            write(args[0], labels[args[1]])
+        elif op == 'mv':
+            write(args[0], reg(args[1]))
+        elif op == 'neg':
+            write(args[0], -reg(args[1]))
+        elif op == 'not':
+            write(args[0], ~reg(args[1]))
+        elif op == 'seqz':
+            write(args[0], int(reg(args[1]) == 0))
+        elif op == 'snez':
+            write(args[0], int(reg(args[1]) != 0))
+        elif op in ALU:
+            write(args[0], ALU[op](reg(args[1]), reg(args[2])))
+        elif op in ALU_IMMEDIATE:
+            write(args[0], ALU[ALU_IMMEDIATE[op]](reg(args[1]), immediate(args[2])))
+        elif op in LOADS:
+            size, signed = LOADS[op]
+            buffer, offset = locate(address_of(args[1]))
+            write(args[0], int.from_bytes(buffer[offset:offset + size], 'little', signed=signed))
+        elif op in STORES:
+            size = STORES[op]
+            buffer, offset = locate(address_of(args[1]))
+            buffer[offset:offset + size] = (reg(args[0]) & ((1 << (8 * size)) - 1)).to_bytes(size, 'little')
+        elif op in BRANCHES:
+            if BRANCHES[op](reg(args[0]), reg(args[1])):
+                pc = labels[args[2]]
+        elif op in BRANCHES_ZERO:
+            if BRANCHES_ZERO[op](reg(args[0])):
+                pc = labels[args[1]]
+        elif op == 'j':
+            pc = labels[args[0]]
+        elif op in ('jal', 'call'):
+            write(args[0] if len(args) == 2 else 'ra', pc)
+            pc = labels[args[-1]]
+        elif op == 'jr':
+            pc = reg(args[0])
+        elif op == 'ret':
+            pc = reg('ra')
+        elif op == 'nop':
+            pass
+        elif op == 'ecall':
+            number = reg('a7')
+            if number == 93:
+                return bytes(streams[1]), bytes(streams[2]), reg('a0'), steps
+            if number == 1:
+                streams[1].extend(str(reg('a1')).encode())
+                continue
+            if number == 11:
+                streams[1].append(reg('a0') & 255)
+                continue
+            if number != 64 or reg('a0') not in streams:
+                raise SimulationError('unsupported ecall %d' % number)
+            buffer, offset = locate(reg('a1'))
+            data = bytes(buffer[offset:offset + reg('a2')])
+            streams[reg('a0')].extend(data)
+            write('a0', len(data))
+        else:
+            raise SimulationError('unknown instruction: ' + raw)
+
+
+def main():
+    if len(sys.argv) < 2:
+        sys.stderr.write('usage: rvsim.py file.s [--max-steps N]\n')
+        return 2
+    max_steps = 50_000_000
+    if '--max-steps' in sys.argv:
+        max_steps = int(sys.argv[sys.argv.index('--max-steps') + 1])
+    try:
+        out, err, code, _ = run(sys.argv[1], max_steps)
+    except SimulationError as error:
+        sys.stderr.write('rvsim: %s\n' % error)
+        return 125
+    sys.stdout.buffer.write(out)
+    sys.stderr.buffer.write(err)
+    return code & 255
+
+
+if __name__ == '__main__':
+    sys.exit(main())